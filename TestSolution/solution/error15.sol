@@ -0,0 +1 @@
+3-25:Char constant wider than one byte.
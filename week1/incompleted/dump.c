@@ -0,0 +1,199 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "dump.h"
+
+#define DUMP_BUFFER_SIZE (1 << 20)
+// Longest record: a position, a name and a token string
+#define MAX_RECORD_LEN 128
+
+/*
+ * Binary dumps start with "KPLB" and a version byte, followed by one
+ * record per token:
+ *   type byte, line as a zigzag varint delta from the previous record,
+ *   column as a varint, then for identifiers, numbers and char constants
+ *   a length byte and the bytes of the token string.
+ * An error is the byte 0xFF, the line and column as above and the error
+ * code byte.
+ */
+#define BINARY_VERSION 1
+#define BINARY_ERROR 0xFF
+
+DumpMode dumpMode = DUMP_PRINTF;
+
+char dumpBuffer[DUMP_BUFFER_SIZE];
+int dumpUsed = 0;
+int lastLineNo = 0;
+
+char *tokenNames[] = {
+  "TK_NONE", "TK_IDENT", "TK_NUMBER", "TK_CHAR", "TK_EOF",
+
+  "KW_PROGRAM", "KW_CONST", "KW_TYPE", "KW_VAR",
+  "KW_INTEGER", "KW_CHAR", "KW_ARRAY", "KW_OF",
+  "KW_FUNCTION", "KW_PROCEDURE",
+  "KW_BEGIN", "KW_END", "KW_CALL",
+  "KW_IF", "KW_THEN", "KW_ELSE",
+  "KW_WHILE", "KW_DO", "KW_FOR", "KW_TO",
+
+  "SB_SEMICOLON", "SB_COLON", "SB_PERIOD", "SB_COMMA",
+  "SB_ASSIGN", "SB_EQ", "SB_NEQ", "SB_LT", "SB_LE", "SB_GT", "SB_GE",
+  "SB_PLUS", "SB_MINUS", "SB_TIMES", "SB_SLASH",
+  "SB_LPAR", "SB_RPAR", "SB_LSEL", "SB_RSEL"
+};
+
+void flushDump(void) {
+  int done = 0, n;
+
+  while (done < dumpUsed) {
+    n = write(1, dumpBuffer + done, dumpUsed - done);
+    if (n <= 0) break;
+    done += n;
+  }
+  dumpUsed = 0;
+}
+
+// Room for one more record
+char *reserveDump(void) {
+  if (dumpUsed + MAX_RECORD_LEN > DUMP_BUFFER_SIZE)
+    flushDump();
+  return dumpBuffer + dumpUsed;
+}
+
+char *putNumber(char *p, int n) {
+  char digits[12];
+  int count = 0;
+  unsigned u = n;
+
+  if (n < 0) {
+    *p++ = '-';
+    u = -u;
+  }
+  do {
+    digits[count++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  while (count > 0)
+    *p++ = digits[--count];
+  return p;
+}
+
+char *putString(char *p, char *s) {
+  int len = strlen(s);
+
+  // Identifiers may run past MAX_IDENT_LEN; records stay bounded
+  if (len > MAX_RECORD_LEN - 48) len = MAX_RECORD_LEN - 48;
+  memcpy(p, s, len);
+  return p + len;
+}
+
+char *putVarint(char *p, unsigned n) {
+  while (n >= 0x80) {
+    *p++ = (n & 0x7F) | 0x80;
+    n >>= 7;
+  }
+  *p++ = n;
+  return p;
+}
+
+char *putPosition(char *p, int lineNo, int colNo) {
+  int delta = lineNo - lastLineNo;
+
+  lastLineNo = lineNo;
+  p = putVarint(p, (delta >= 0) ? 2 * (unsigned) delta : 2 * (unsigned) -delta - 1);
+  return putVarint(p, colNo);
+}
+
+void beginDump(DumpMode mode) {
+  dumpMode = mode;
+  dumpUsed = 0;
+  lastLineNo = 0;
+  if (mode == DUMP_BINARY) {
+    memcpy(dumpBuffer, "KPLB", 4);
+    dumpBuffer[4] = BINARY_VERSION;
+    dumpUsed = 5;
+  }
+}
+
+void dumpText(Token *token) {
+  char *p = reserveDump();
+
+  p = putNumber(p, token->lineNo);
+  *p++ = '-';
+  p = putNumber(p, token->colNo);
+  *p++ = ':';
+  // An over-long identifier may have run into the type; printToken then
+  // prints the position alone
+  if ((unsigned) token->tokenType > SB_RSEL) {
+    dumpUsed = p - dumpBuffer;
+    return;
+  }
+  p = putString(p, tokenNames[token->tokenType]);
+  switch (token->tokenType) {
+  case TK_IDENT:
+  case TK_NUMBER:
+    *p++ = '(';
+    p = putString(p, token->string);
+    *p++ = ')';
+    break;
+  case TK_CHAR:
+    *p++ = '(';
+    *p++ = '\'';
+    p = putString(p, token->string);
+    *p++ = '\'';
+    *p++ = ')';
+    break;
+  default:
+    break;
+  }
+  *p++ = '\n';
+  dumpUsed = p - dumpBuffer;
+}
+
+void dumpBinary(Token *token) {
+  char *p = reserveDump();
+  char *len;
+
+  *p++ = token->tokenType;
+  p = putPosition(p, token->lineNo, token->colNo);
+  switch (token->tokenType) {
+  case TK_IDENT:
+  case TK_NUMBER:
+  case TK_CHAR:
+    len = p++;
+    p = putString(p, token->string);
+    *len = p - len - 1;
+    break;
+  default:
+    break;
+  }
+  dumpUsed = p - dumpBuffer;
+}
+
+void dumpToken(Token *token) {
+  if (dumpMode == DUMP_BINARY)
+    dumpBinary(token);
+  else dumpText(token);
+}
+
+void dumpError(ErrorCode err, int lineNo, int colNo, char *message) {
+  char *p = reserveDump();
+
+  if (dumpMode == DUMP_BINARY) {
+    *p++ = (char) BINARY_ERROR;
+    p = putPosition(p, lineNo, colNo);
+    *p++ = err;
+  } else {
+    p = putNumber(p, lineNo);
+    *p++ = '-';
+    p = putNumber(p, colNo);
+    *p++ = ':';
+    p = putString(p, message);
+    *p++ = '\n';
+  }
+  dumpUsed = p - dumpBuffer;
+}
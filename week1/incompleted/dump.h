@@ -0,0 +1,29 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __DUMP_H__
+#define __DUMP_H__
+
+#include "token.h"
+#include "error.h"
+
+// How the scanner writes tokens and errors: with printf (the default), as
+// the same text formatted into a large buffer that is written out whole,
+// or as binary records in such a buffer
+typedef enum {
+  DUMP_PRINTF,
+  DUMP_TEXT,
+  DUMP_BINARY
+} DumpMode;
+
+extern DumpMode dumpMode;
+
+void beginDump(DumpMode mode);
+void dumpToken(Token *token);
+void dumpError(ErrorCode err, int lineNo, int colNo, char *message);
+void flushDump(void);
+
+#endif
@@ -7,27 +7,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "error.h"
+#include "dump.h"
 
 void error(ErrorCode err, int lineNo, int colNo) {
+  char *message = "";
+
   switch (err) {
   case ERR_ENDOFCOMMENT:
-    printf("%d-%d:%s\n", lineNo, colNo, ERM_ENDOFCOMMENT);
+    message = ERM_ENDOFCOMMENT;
     break;
   case ERR_IDENTTOOLONG:
-    printf("%d-%d:%s\n", lineNo, colNo, ERM_IDENTTOOLONG);
+    message = ERM_IDENTTOOLONG;
     break;
   case ERR_INVALIDCHARCONSTANT:
-    printf("%d-%d:%s\n", lineNo, colNo, ERM_INVALIDCHARCONSTANT);
+    message = ERM_INVALIDCHARCONSTANT;
     break;
   case ERR_INVALIDSYMBOL:
-    printf("%d-%d:%s\n", lineNo, colNo, ERM_INVALIDSYMBOL);
+    message = ERM_INVALIDSYMBOL;
     break;
   // CuongDD: 20/8/2014
   case ERR_NUMBERTOOLONG:
-    printf("%d-%d:%s\n", lineNo, colNo, ERM_NUMBERTOOLONG);
+    message = ERM_NUMBERTOOLONG;
     break;
   }
-  if(err != ERR_IDENTTOOLONG)
-	  exit(-1);
+  if (dumpMode == DUMP_PRINTF)
+    printf("%d-%d:%s\n", lineNo, colNo, message);
+  else dumpError(err, lineNo, colNo, message);
+  if(err != ERR_IDENTTOOLONG) {
+    flushDump();
+    exit(-1);
+  }
 }
-
@@ -12,6 +12,7 @@
 #include "charcode.h"
 #include "token.h"
 #include "error.h"
+#include "dump.h"
 
 
 extern int lineNo;
@@ -302,12 +303,15 @@ int scan(char *fileName) {
 
   token = getToken();
   while (token->tokenType != TK_EOF) {
-    printToken(token);
+    if (dumpMode == DUMP_PRINTF)
+      printToken(token);
+    else dumpToken(token);
     free(token);
     token = getToken();
   }
 
   free(token);
+  flushDump();
   closeInputStream();
   return IO_SUCCESS;
 }
@@ -315,12 +319,24 @@ int scan(char *fileName) {
 /******************************************************************/
 
 int main(int argc, char *argv[]) {
-  if (argc <= 1) {
+  int arg = 1;
+
+  // -f: the same text as printToken, written in large blocks
+  // -b: a compact binary dump (see dump.c)
+  if ((argc > arg) && (strcmp(argv[arg], "-f") == 0)) {
+    beginDump(DUMP_TEXT);
+    arg ++;
+  } else if ((argc > arg) && (strcmp(argv[arg], "-b") == 0)) {
+    beginDump(DUMP_BINARY);
+    arg ++;
+  }
+
+  if (argc <= arg) {
     printf("scanner: no input file.\n");
     return -1;
   }
 
-  if (scan(argv[1]) == IO_ERROR) {
+  if (scan(argv[arg]) == IO_ERROR) {
     printf("Can\'t read input file!\n");
     return -1;
   }
@@ -0,0 +1,123 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "context.h"
+
+#define INITIAL_NODE_CAPACITY 1024
+
+char *nodeKindNames[NODE_KINDS] = {
+  "Program", "Block", "Const", "Type", "Var", "Function", "Procedure",
+  "Param", "Param VAR",
+  "Int", "Char", "Arr", "TypeRef",
+  "Empty", "Assign", "Call", "Group", "If", "While", "For", "Body",
+  "Number", "CharConst", "ConstRef", "Variable", "FuncCall", "Unary", "Binary"
+};
+
+const char *nodeKindName(NodeKind kind) {
+  return nodeKindNames[kind];
+}
+
+void growAst(void) {
+  NodeId capacity = (compiler->ast.capacity == 0) ? INITIAL_NODE_CAPACITY : compiler->ast.capacity * 2;
+
+  compiler->ast.kinds = (unsigned char*) realloc(compiler->ast.kinds, capacity);
+  compiler->ast.children = (NodeId*) realloc(compiler->ast.children, capacity * sizeof(NodeId));
+  compiler->ast.siblings = (NodeId*) realloc(compiler->ast.siblings, capacity * sizeof(NodeId));
+  compiler->ast.payloads = (NodePayload*) realloc(compiler->ast.payloads, capacity * sizeof(NodePayload));
+  compiler->ast.offsets = (SourcePos*) realloc(compiler->ast.offsets, capacity * sizeof(SourcePos));
+  compiler->ast.capacity = capacity;
+  if (compiler->ast.count == 0)
+    compiler->ast.count = 1;
+}
+
+NodeId addNode(NodeKind kind, SourcePos offset) {
+  NodeId node;
+  OpenNode *parent;
+
+  if (compiler->ast.count == compiler->ast.capacity)
+    growAst();
+  node = compiler->ast.count ++;
+  compiler->ast.kinds[node] = kind;
+  compiler->ast.children[node] = 0;
+  compiler->ast.siblings[node] = 0;
+  compiler->ast.payloads[node].value = 0;
+  compiler->ast.offsets[node] = offset;
+
+  if (compiler->openCount == 0) {
+    compiler->astRoot = node;
+    return node;
+  }
+  parent = &compiler->openNodes[compiler->openCount - 1];
+  if (parent->last == 0)
+    compiler->ast.children[parent->node] = node;
+  else compiler->ast.siblings[parent->last] = node;
+  parent->last = node;
+  return node;
+}
+
+void openNode(NodeId node) {
+  if (compiler->openCount == compiler->openCapacity) {
+    compiler->openCapacity = (compiler->openCapacity == 0) ? 64 : compiler->openCapacity * 2;
+    compiler->openNodes = (OpenNode*) realloc(compiler->openNodes, compiler->openCapacity * sizeof(OpenNode));
+  }
+  compiler->openNodes[compiler->openCount].node = node;
+  compiler->openNodes[compiler->openCount].last = 0;
+  compiler->openCount ++;
+}
+
+NodeId beginNode(NodeKind kind, SourcePos offset) {
+  NodeId node = addNode(kind, offset);
+
+  openNode(node);
+  return node;
+}
+
+void reopenNode(NodeId node, NodeKind kind) {
+  compiler->ast.kinds[node] = kind;
+  openNode(node);
+}
+
+NodeId wrapNode(NodeKind kind, SourcePos offset) {
+  OpenNode *parent = &compiler->openNodes[compiler->openCount - 1];
+  NodeId operand = parent->last;
+  NodeId node;
+
+  // Unlink the operand; it is the only child or follows the one before
+  if (compiler->ast.children[parent->node] == operand) {
+    compiler->ast.children[parent->node] = 0;
+    parent->last = 0;
+  } else {
+    for (node = compiler->ast.children[parent->node]; compiler->ast.siblings[node] != operand; node = compiler->ast.siblings[node]) ;
+    compiler->ast.siblings[node] = 0;
+    parent->last = node;
+  }
+
+  node = beginNode(kind, offset);
+  compiler->ast.children[node] = operand;
+  compiler->openNodes[compiler->openCount - 1].last = operand;
+  return node;
+}
+
+void endNode(void) {
+  compiler->openCount --;
+}
+
+void freeAst(void) {
+  free(compiler->ast.kinds);
+  free(compiler->ast.children);
+  free(compiler->ast.siblings);
+  free(compiler->ast.payloads);
+  free(compiler->ast.offsets);
+  compiler->ast.kinds = NULL;
+  compiler->ast.children = NULL;
+  compiler->ast.siblings = NULL;
+  compiler->ast.payloads = NULL;
+  compiler->ast.offsets = NULL;
+  compiler->ast.count = compiler->ast.capacity = 0;
+  compiler->astRoot = 0;
+  compiler->openCount = 0;
+}
@@ -0,0 +1,109 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __AST_H__
+#define __AST_H__
+
+#include "token.h"
+
+// Children of each kind, in order; name, value, text or op tells which
+// payload member is used
+typedef enum {
+  // Declarations
+  N_PROGRAM,            // name: block
+  N_BLOCK,              // declarations, then the body as an N_GROUP
+  N_CONST_DECL,         // name: constant
+  N_TYPE_DECL,          // name: type
+  N_VAR_DECL,           // name: type
+  N_FUNC_DECL,          // name: parameters, return type, block
+  N_PROC_DECL,          // name: parameters, block
+  N_VALUE_PARAM,        // name: type
+  N_REF_PARAM,          // name: type
+
+  // Types
+  N_INT_TYPE,
+  N_CHAR_TYPE,
+  N_ARRAY_TYPE,         // value, the size: element type
+  N_NAMED_TYPE,         // name
+
+  // Statements
+  N_EMPTY,
+  N_ASSIGN,             // lvalue, expression
+  N_CALL,               // name: arguments
+  N_GROUP,              // statements
+  N_IF,                 // condition, statement [, else statement]
+  N_WHILE,              // condition, statement
+  N_FOR,                // name: first, last, statement
+  // A body left out in outline mode; it becomes an N_GROUP when parsed
+  N_BODY,               // value, the index of the skipped body
+
+  // Expressions and constants. An lvalue is an N_VARIABLE, which also
+  // stands for parameters and, on the left of :=, the function result.
+  N_NUMBER,             // value
+  N_CHAR,               // text
+  N_CONST_REF,          // name
+  N_VARIABLE,           // name: indexes
+  N_FUNC_CALL,          // name: arguments
+  N_UNARY,              // op: operand
+  N_BINARY,             // op, arithmetic or comparison: left, right
+
+  NODE_KINDS
+} NodeKind;
+
+// What a node carries besides its kind and children
+typedef union {
+  Atom name;
+  int value;
+  char text[4];
+  TokenType op;
+} NodePayload;
+
+// Nodes are numbered from 1 and 0 is no node
+typedef unsigned int NodeId;
+
+/*
+ * The tree is held as parallel arrays indexed by node, linked by the
+ * number of the first child and of the next sibling. The arrays hold no
+ * pointers, so they can be written out and read back as they are.
+ */
+typedef struct {
+  unsigned char *kinds;         // a NodeKind
+  NodeId *children;             // first child
+  NodeId *siblings;             // next sibling
+  NodePayload *payloads;
+  SourcePos *offsets;           // first token of the construct
+  NodeId count;                 // nodes in use, counting the unused 0
+  NodeId capacity;
+} SyntaxTree;
+
+// Nodes opened by beginNode and not yet ended, each with its last child
+typedef struct {
+  NodeId node;
+  NodeId last;
+} OpenNode;
+
+// The tree of the calling thread's context is read with nodeKind,
+// firstChild, nextSibling and nodePayload of context.h
+
+/*
+ * The parser builds the tree top down. beginNode appends a node to the
+ * open one and opens it, so that the nodes added until the matching
+ * endNode become its children; addNode appends a leaf. wrapNode is for
+ * left operands, which are parsed before their operator is known: the
+ * last node added to the open one is moved under a new open node.
+ */
+NodeId beginNode(NodeKind kind, SourcePos offset);
+NodeId addNode(NodeKind kind, SourcePos offset);
+NodeId wrapNode(NodeKind kind, SourcePos offset);
+// Opens a childless node added before, as kind; for a body parsed later
+void reopenNode(NodeId node, NodeKind kind);
+void endNode(void);
+
+const char *nodeKindName(NodeKind kind);
+// Releases the whole tree
+void freeAst(void);
+
+#endif
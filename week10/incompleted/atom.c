@@ -0,0 +1,146 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "context.h"
+
+#define INITIAL_ATOM_SLOTS 256
+#define NAME_BLOCK_SIZE 4096
+
+unsigned hashName(const char *name, int length) {
+  unsigned h = 2166136261u;
+  int i;
+
+  for (i = 0; i < length; i ++)
+    h = (h ^ (unsigned char) name[i]) * 16777619u;
+  return h;
+}
+
+unsigned hashSpan(const unsigned char *text, int length) {
+  unsigned h = 2166136261u;
+  int i;
+
+  for (i = 0; i < length; i ++)
+    h = (h ^ upperAscii(text[i])) * 16777619u;
+  return h;
+}
+
+char *allocName(int size) {
+  char *block;
+
+  if ((compiler->nameBlock == NULL) || (compiler->nameBlockUsed + size > NAME_BLOCK_SIZE)) {
+    block = (char*) malloc(NAME_BLOCK_SIZE);
+    *(char**) block = compiler->nameBlock;
+    compiler->nameBlock = block;
+    compiler->nameBlockUsed = sizeof(char*);
+  }
+  block = compiler->nameBlock + compiler->nameBlockUsed;
+  compiler->nameBlockUsed += size;
+  return block;
+}
+
+void growAtomSlots(void) {
+  Atom *old = compiler->atomSlots;
+  int oldCount = compiler->atomSlotCount;
+  const char *name;
+  int i, j;
+
+  compiler->atomSlotCount = (oldCount == 0) ? INITIAL_ATOM_SLOTS : oldCount * 2;
+  compiler->atomSlots = (Atom*) calloc(compiler->atomSlotCount, sizeof(Atom));
+  for (i = 0; i < oldCount; i ++) {
+    if (old[i] == 0) continue;
+    name = compiler->atomNames[old[i]];
+    j = hashName(name, strlen(name)) & (compiler->atomSlotCount - 1);
+    while (compiler->atomSlots[j] != 0)
+      j = (j + 1) & (compiler->atomSlotCount - 1);
+    compiler->atomSlots[j] = old[i];
+  }
+  free(old);
+}
+
+// Adds the name of length bytes in slot i, which is free
+char *addAtom(int i, int length) {
+  char *text;
+
+  if (compiler->atomCount + 2 > compiler->atomNameCapacity) {
+    compiler->atomNameCapacity = (compiler->atomNameCapacity == 0) ? INITIAL_ATOM_SLOTS : compiler->atomNameCapacity * 2;
+    compiler->atomNames = (const char**) realloc(compiler->atomNames, compiler->atomNameCapacity * sizeof(char*));
+    compiler->atomNames[0] = NULL;
+  }
+
+  text = allocName(length + 1);
+  text[length] = '\0';
+  compiler->atomCount ++;
+  compiler->atomNames[compiler->atomCount] = text;
+  compiler->atomSlots[i] = compiler->atomCount;
+  return text;
+}
+
+Atom internName(const char *name, int length) {
+  const char *other;
+  int i;
+
+  if (2 * (compiler->atomCount + 1) > compiler->atomSlotCount)
+    growAtomSlots();
+
+  i = hashName(name, length) & (compiler->atomSlotCount - 1);
+  while (compiler->atomSlots[i] != 0) {
+    other = compiler->atomNames[compiler->atomSlots[i]];
+    if ((strncmp(other, name, length) == 0) && (other[length] == '\0'))
+      return compiler->atomSlots[i];
+    i = (i + 1) & (compiler->atomSlotCount - 1);
+  }
+
+  memcpy(addAtom(i, length), name, length);
+  return compiler->atomCount;
+}
+
+Atom internSpan(const unsigned char *text, int length) {
+  const char *other;
+  char *name;
+  int i, k;
+
+  if (2 * (compiler->atomCount + 1) > compiler->atomSlotCount)
+    growAtomSlots();
+
+  // Stored names are in upper case, so their own hash is the folded one
+  i = hashSpan(text, length) & (compiler->atomSlotCount - 1);
+  while (compiler->atomSlots[i] != 0) {
+    other = compiler->atomNames[compiler->atomSlots[i]];
+    for (k = 0; (k < length) && (other[k] == upperAscii(text[k])); k ++) ;
+    if ((k == length) && (other[length] == '\0'))
+      return compiler->atomSlots[i];
+    i = (i + 1) & (compiler->atomSlotCount - 1);
+  }
+
+  name = addAtom(i, length);
+  for (k = 0; k < length; k ++)
+    name[k] = upperAscii(text[k]);
+  return compiler->atomCount;
+}
+
+Atom internString(const char *name) {
+  return internName(name, strlen(name));
+}
+
+void freeAtoms(void) {
+  char *block;
+
+  while (compiler->nameBlock != NULL) {
+    block = compiler->nameBlock;
+    compiler->nameBlock = *(char**) block;
+    free(block);
+  }
+  free(compiler->atomSlots);
+  free(compiler->atomNames);
+  compiler->atomSlots = NULL;
+  compiler->atomNames = NULL;
+  compiler->atomSlotCount = 0;
+  compiler->atomNameCapacity = 0;
+  compiler->atomCount = 0;
+  compiler->nameBlockUsed = 0;
+}
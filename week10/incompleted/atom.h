@@ -0,0 +1,30 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ATOM_H__
+#define __ATOM_H__
+
+// An interned name: every distinct spelling is stored once and numbered,
+// so two atoms are the same name exactly when the numbers are equal. The
+// number is small enough for the payload of a token; atomName gives the
+// NUL terminated text, which stays valid until freeAtoms.
+typedef unsigned int Atom;
+
+// The text of an atom is atomName (see context.h)
+
+// ASCII letters in upper case, other bytes unchanged
+static inline unsigned char upperAscii(unsigned char c) {
+  return ((c >= 'a') && (c <= 'z')) ? c - ('a' - 'A') : c;
+}
+
+Atom internName(const char *name, int length);
+// The atom of the upper case spelling of length bytes of source text,
+// found without copying them; equal to internName of the folded text
+Atom internSpan(const unsigned char *text, int length);
+Atom internString(const char *name);
+void freeAtoms(void);
+
+#endif
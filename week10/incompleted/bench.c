@@ -0,0 +1,193 @@
+/* Scanner benchmark
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "reader.h"
+#include "scanner.h"
+#include "relex.h"
+#include "tkcache.h"
+#include "context.h"
+
+#define DEFAULT_COPIES 10000
+
+// Text typed by checkEdits: it opens and closes comments and char
+// constants, and holds a multi-byte character and a malformed one
+const char *snippets[] = {
+  "x", "1", " ", "\n", "(*", "*)", "'", "'a'", ":=", "(", ".",
+  "BEGIN", "\xc3\xa9", "\xc3", "99999999999", "AVERYLONGIDENTIFIER"
+};
+#define NUM_OF_SNIPPETS (sizeof(snippets) / sizeof(snippets[0]))
+
+char *loadCopies(char *fileName, long copies, size_t *length) {
+  FILE *f = fopen(fileName, "rb");
+  char *text, *buffer;
+  long size, i;
+
+  if (f == NULL)
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  text = (char*) malloc(size);
+  if (fread(text, 1, size, f) != (size_t) size) {
+    fclose(f);
+    free(text);
+    return NULL;
+  }
+  fclose(f);
+
+  buffer = (char*) malloc(size * copies);
+  for (i = 0; i < copies; i++)
+    memcpy(buffer + i * size, text, size);
+  free(text);
+
+  *length = size * copies;
+  return buffer;
+}
+
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Types a character at pseudo-random places and deletes it again
+void benchEdits(char *buffer, size_t length, long edits) {
+  LexedSource source;
+  unsigned long seed = 12345;
+  long i, offset, lexed = 0;
+  double start, elapsed;
+
+  openLexedSource(&source, buffer, length);
+  start = now();
+  for (i = 0; i < edits; i ++) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    offset = (seed >> 33) % length;
+    lexed += editSource(&source, offset, 0, "x", 1);
+    lexed += editSource(&source, offset, 1, "", 0);
+  }
+  elapsed = now() - start;
+  closeLexedSource(&source);
+
+  printf("%ld edits: %.2f us and %.1f tokens lexed per edit\n",
+	 2 * edits, elapsed / (2 * edits) * 1e6, (double) lexed / (2 * edits));
+}
+
+// Makes random edits to the text and, after each one, compares the
+// tokens editSource keeps with a fresh scan of the whole text. Returns
+// the number of edits after which they differ.
+long checkEdits(char *fileName, char *text, size_t length, long edits) {
+  LexedSource source;
+  TokenBuffer fresh;
+  unsigned long seed = 12345;
+  long i, offset, removed, diff, failed = 0;
+  const char *inserted;
+
+  openLexedSource(&source, text, length);
+  for (i = 0; i < edits; i ++) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    offset = (seed >> 33) % (source.size + 1);
+    removed = (seed >> 20) % 4;
+    if (removed > source.size - offset)
+      removed = source.size - offset;
+    inserted = ((seed >> 12) % 3 == 0) ? "" : snippets[(seed >> 24) % NUM_OF_SNIPPETS];
+    editSource(&source, offset, removed, inserted, strlen(inserted));
+
+    initTokenBuffer(&fresh);
+    openInputBuffer(source.text, source.size, fileName);
+    tokenizeInput(&fresh);
+    closeInputStream();
+    diff = compareTokens(&source.tokens, &fresh);
+    if (diff >= 0) {
+      printf("%s: edit %ld at %ld: token %ld differs from a fresh scan\n",
+	     fileName, i, offset, diff);
+      failed ++;
+    }
+    freeTokenBuffer(&fresh);
+  }
+  closeLexedSource(&source);
+  return failed;
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  long copies = DEFAULT_COPIES;
+  long edits = 0;
+  long tokens = 0;
+  long failed = 0;
+  int arg;
+  size_t length;
+  char *buffer;
+  Token *token;
+  double start, elapsed;
+
+  if (argc <= 1) {
+    printf("kplbench: no input file.\n");
+    printf("usage: kplbench file [copies [edits]]\n");
+    printf("       kplbench -r edits file...\n");
+    return -1;
+  }
+
+  // -r: check editSource against a fresh scan on each file
+  if ((strcmp(argv[1], "-r") == 0) && (argc > 3)) {
+    useCompiler(createCompiler());
+    for (arg = 3; arg < argc; arg ++) {
+      buffer = loadCopies(argv[arg], 1, &length);
+      if (buffer == NULL) {
+	printf("Can\'t read input file %s!\n", argv[arg]);
+	return -1;
+      }
+      failed += checkEdits(argv[arg], buffer, length, atol(argv[2]));
+      free(buffer);
+    }
+    freeCompiler(compiler);
+    return (failed == 0) ? 0 : 1;
+  }
+
+  if (argc > 2)
+    copies = atol(argv[2]);
+  if (argc > 3)
+    edits = atol(argv[3]);
+
+  buffer = loadCopies(argv[1], copies, &length);
+  if (buffer == NULL) {
+    printf("Can\'t read input file!\n");
+    return -1;
+  }
+
+  useCompiler(createCompiler());
+  // A scan error ends the run, as it ends a compilation
+  if (setjmp(compiler->errorExit) != 0)
+    return 0;
+
+  start = now();
+  openInputBuffer(buffer, length, argv[1]);
+  do {
+    token = getToken();
+    tokens ++;
+    if (token->tokenType == TK_EOF) break;
+    freeToken(token);
+  } while (1);
+  freeToken(token);
+  closeInputStream();
+  elapsed = now() - start;
+
+  printf("%s x %ld: %lu bytes, %ld tokens in %.3f s (%.1f MB/s, %.1f Mtokens/s)\n",
+	 argv[1], copies, (unsigned long) length, tokens, elapsed,
+	 length / elapsed / 1e6, tokens / elapsed / 1e6);
+  if (edits > 0)
+    benchEdits(buffer, length, edits);
+
+  free(buffer);
+  freeCompiler(compiler);
+  return 0;
+}
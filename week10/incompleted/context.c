@@ -0,0 +1,54 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "context.h"
+#include "atom.h"
+#include "dfa.h"
+#include "vscan.h"
+#include "utf8.h"
+
+__thread CompilerContext *compiler = NULL;
+
+pthread_once_t sharedTablesOnce = PTHREAD_ONCE_INIT;
+
+// The tables and kernel choices are shared by all contexts, so they are
+// set up before any context is handed out
+void buildSharedTables(void) {
+  buildDfa();
+  buildKeywordSlots();
+  initVscan();
+  initUtf8();
+}
+
+CompilerContext *createCompiler(void) {
+  CompilerContext *context = (CompilerContext*) calloc(1, sizeof(CompilerContext));
+
+  pthread_once(&sharedTablesOnce, buildSharedTables);
+  context->lexThreads = 1;
+  context->maxErrors = 1;
+  context->inputFd = -1;
+  return context;
+}
+
+void freeCompiler(CompilerContext *context) {
+  CompilerContext *current = compiler;
+
+  compiler = context;
+  freeTokenPool();
+  freeAtoms();
+  compiler = current;
+  free(context->openNodes);
+  free(context->llStack);
+  free(context->bodies);
+  free(context);
+}
+
+void useCompiler(CompilerContext *context) {
+  compiler = context;
+}
@@ -0,0 +1,178 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CONTEXT_H__
+#define __CONTEXT_H__
+
+#include <setjmp.h>
+#include "reader.h"
+#include "token.h"
+#include "tokbuf.h"
+#include "symtab.h"
+#include "ast.h"
+#include "parser.h"
+
+/*
+ * Everything a compilation changes. Each thread compiles in the context
+ * that compiler points to, so units can be compiled on several threads at
+ * once, one context each. Only tables that are built once and then read,
+ * like the keyword table and the scanner DFA, are shared.
+ */
+typedef struct CompilerContext {
+  // Options, set before compiling
+  int preTokenize;              // scan the whole unit before parsing
+  int lexThreads;               // threads to scan it with
+  const char *tokenCacheDir;    // token cache files, NULL for none
+  int validateCache;            // check the cache against a fresh scan
+  int printTree;                // print the syntax tree as well
+  int checkSyntaxOnly;          // use the table driven parser of llparse.c
+  int maxErrors;                // stop at this many errors; 0 is no limit
+  int outline;                  // skip the bodies, keeping declarations
+  const char *outlineBody;      // with outline, compile the bodies of this
+                                // name afterwards
+
+  // [inputStart, inputEnd) is the part of the source held in memory and
+  // inputBase its offset in the file. Usually this is the whole source,
+  // mapped or read into a buffer; sources over MAX_MAPPED_INPUT are
+  // streamed through a fixed-size window instead. inputPtr points to the
+  // byte following currentChar.
+  const unsigned char *inputPtr;
+  const unsigned char *inputEnd;
+  const unsigned char *inputStart;
+  SourcePos inputBase;
+  int currentChar;
+  // Display name used to prefix diagnostics, NULL when reading a named file
+  const char *inputName;
+
+  unsigned char *inputBuffer;
+  size_t inputSize;
+  InputKind inputKind;
+
+  // Offsets at which each line starts, built on the first position lookup
+  SourcePos *lineStarts;
+  SourcePos lineCount;
+
+  // Streamed input: the file stays open and only the window is resident.
+  // anchorLineNo and anchorLineStart describe the line containing inputBase.
+  int inputFd;
+  SourcePos anchorLineNo;
+  SourcePos anchorLineStart;
+
+  // Freed tokens, and the blocks all tokens were allocated from
+  TokenSlot *freeSlots;
+  TokenSlot *tokenBlocks;
+
+  // Open addressing table of atoms, kept at most half full; 0 marks a free
+  // slot
+  Atom *atomSlots;
+  int atomSlotCount;
+  int atomCount;
+
+  // Indexed by atom; entry 0 is no name and atoms run from 1 to atomCount
+  // in the order they were first interned
+  const char **atomNames;
+  int atomNameCapacity;
+
+  // Names are copied into blocks that never move, so atom names stay valid
+  // while the tables grow. Each block starts with a link to the previous one.
+  char *nameBlock;
+  int nameBlockUsed;
+
+  Token *currentToken;
+  Token *lookAhead;
+
+  // Tokens scanned beyond lookAhead by peekToken, oldest first
+  Token *lookAheadRing[MAX_LOOKAHEAD];
+  int ringFirst;
+  int ringCount;
+
+  // With preTokenize set, the whole unit is scanned into tokens before
+  // parsing starts and the parser walks it by tokenIndex
+  TokenBuffer unitTokens;
+  long tokenIndex;
+  // While tokenizeInput runs, lexical errors go into this buffer as
+  // TK_NONE entries and are reported when the parser reaches them
+  TokenBuffer *lexErrors;
+
+  // Set from a syntax error until the parser is back in step
+  int panicking;
+
+  // Bodies skipped in outline mode, in source order
+  SkippedBody *bodies;
+  int bodyCount;
+  int bodyCapacity;
+
+  int errorCount;
+  // Where the compilation ends at the maxErrors-th error
+  jmp_buf errorExit;
+
+  SymTab* symtab;
+  Type* intType;
+  Type* charType;
+  // Stand-in objects for identifiers in error
+  ObjectNode *errorObjects;
+
+  SyntaxTree ast;
+  NodeId astRoot;
+  OpenNode *openNodes;
+  int openCount;
+  int openCapacity;
+
+  // Symbols still to be matched by checkSyntax, the next one on top
+  unsigned char *llStack;
+  int llStackSize;
+} CompilerContext;
+
+// The context of the calling thread
+extern __thread CompilerContext *compiler;
+
+static inline int readChar(void) {
+  compiler->currentChar = (compiler->inputPtr < compiler->inputEnd) ?
+    *compiler->inputPtr++ : refillInput();
+  return compiler->currentChar;
+}
+
+// Moves the reader to p, which lies in [inputPtr - 1, inputEnd]
+static inline void advanceTo(const unsigned char *p) {
+  compiler->inputPtr = p;
+  readChar();
+}
+
+// Position of currentChar; EOF sits one past the last byte
+static inline SourcePos currentPos(void) {
+  if (compiler->currentChar == EOF)
+    return compiler->inputBase + (compiler->inputEnd - compiler->inputStart);
+  return compiler->inputBase + (compiler->inputPtr - compiler->inputStart) - 1;
+}
+
+static inline const char *atomName(Atom atom) {
+  return compiler->atomNames[atom];
+}
+
+static inline NodeKind nodeKind(NodeId node) {
+  return (NodeKind) compiler->ast.kinds[node];
+}
+
+static inline NodeId firstChild(NodeId node) {
+  return compiler->ast.children[node];
+}
+
+static inline NodeId nextSibling(NodeId node) {
+  return compiler->ast.siblings[node];
+}
+
+// Valid until the next node is added
+static inline NodePayload *nodePayload(NodeId node) {
+  return &compiler->ast.payloads[node];
+}
+
+// A context with the default options, not yet in use
+CompilerContext *createCompiler(void);
+void freeCompiler(CompilerContext *context);
+// Makes context the one of the calling thread
+void useCompiler(CompilerContext *context);
+
+#endif
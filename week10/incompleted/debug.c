@@ -5,11 +5,12 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "debug.h"
+#include "context.h"
 
 void pad(int n) {
-  int i;
-  for (i = 0; i < n ; i++) printf(" ");
+  printf("%*s", n, "");
 }
 
 void printType(Type* type) {
@@ -45,42 +46,42 @@ void printObject(Object* obj, int indent) {
   switch (obj->kind) {
   case OBJ_CONSTANT:
     pad(indent);
-    printf("Const %s = ", obj->name);
+    printf("Const %s = ", atomName(obj->name));
     printConstantValue(obj->constAttrs->value);
     break;
   case OBJ_TYPE:
     pad(indent);
-    printf("Type %s = ", obj->name);
+    printf("Type %s = ", atomName(obj->name));
     printType(obj->typeAttrs->actualType);
     break;
   case OBJ_VARIABLE:
     pad(indent);
-    printf("Var %s : ", obj->name);
+    printf("Var %s : ", atomName(obj->name));
     printType(obj->varAttrs->type);
     break;
   case OBJ_PARAMETER:
     pad(indent);
     if (obj->paramAttrs->kind == PARAM_VALUE) 
-      printf("Param %s : ", obj->name);
+      printf("Param %s : ", atomName(obj->name));
     else
-      printf("Param VAR %s : ", obj->name);
+      printf("Param VAR %s : ", atomName(obj->name));
     printType(obj->paramAttrs->type);
     break;
   case OBJ_FUNCTION:
     pad(indent);
-    printf("Function %s : ",obj->name);
+    printf("Function %s : ",atomName(obj->name));
     printType(obj->funcAttrs->returnType);
     printf("\n");
     printScope(obj->funcAttrs->scope, indent + 4);
     break;
   case OBJ_PROCEDURE:
     pad(indent);
-    printf("Procedure %s\n",obj->name);
+    printf("Procedure %s\n",atomName(obj->name));
     printScope(obj->procAttrs->scope, indent + 4);
     break;
   case OBJ_PROGRAM:
     pad(indent);
-    printf("Program %s\n",obj->name);
+    printf("Program %s\n",atomName(obj->name));
     printScope(obj->progAttrs->scope, indent + 4);
     break;
   }
@@ -99,3 +100,77 @@ void printScope(Scope* scope, int indent) {
   printObjectList(scope->objList, indent);
 }
 
+
+// Lines of a syntax tree are indented by at most this much; deeper nodes
+// are printed at this indent, after their depth
+#define MAX_TREE_INDENT 160
+
+void printNodeLine(NodeId node, int indent) {
+  if (indent > MAX_TREE_INDENT) {
+    pad(MAX_TREE_INDENT);
+    printf("[%d] ", indent / 4);
+  } else pad(indent);
+
+  printf("%s", nodeKindName(nodeKind(node)));
+  switch (nodeKind(node)) {
+  case N_PROGRAM: case N_CONST_DECL: case N_TYPE_DECL: case N_VAR_DECL:
+  case N_FUNC_DECL: case N_PROC_DECL: case N_VALUE_PARAM: case N_REF_PARAM:
+  case N_NAMED_TYPE: case N_CALL: case N_FOR:
+  case N_CONST_REF: case N_VARIABLE: case N_FUNC_CALL:
+    printf(" %s", atomName(nodePayload(node)->name));
+    break;
+  case N_ARRAY_TYPE:
+  case N_NUMBER:
+  case N_BODY:
+    printf(" %d", nodePayload(node)->value);
+    break;
+  case N_CHAR:
+    printf(" \'%.4s\'", nodePayload(node)->text);
+    break;
+  case N_UNARY:
+  case N_BINARY:
+    printf(" %s", tokenToString(nodePayload(node)->op));
+    break;
+  default:
+    break;
+  }
+  printf("\n");
+}
+
+// Walks the tree with a stack of its own, as expressions can nest
+// deeper than the C stack allows. The stack holds the nodes still to be
+// printed, at most one per level: the next sibling of each open node.
+void printNode(NodeId node, int indent) {
+  NodeId *nodes;
+  int *indents;
+  int count = 0, capacity = 64;
+
+  nodes = (NodeId*) malloc(capacity * sizeof(NodeId));
+  indents = (int*) malloc(capacity * sizeof(int));
+  printNodeLine(node, indent);
+  nodes[count] = firstChild(node);
+  indents[count] = indent + 4;
+  count ++;
+
+  while (count > 0) {
+    count --;
+    node = nodes[count];
+    indent = indents[count];
+    if (node == 0) continue;
+
+    printNodeLine(node, indent);
+    if (count + 2 > capacity) {
+      capacity *= 2;
+      nodes = (NodeId*) realloc(nodes, capacity * sizeof(NodeId));
+      indents = (int*) realloc(indents, capacity * sizeof(int));
+    }
+    nodes[count] = nextSibling(node);
+    indents[count] = indent;
+    count ++;
+    nodes[count] = firstChild(node);
+    indents[count] = indent + 4;
+    count ++;
+  }
+  free(nodes);
+  free(indents);
+}
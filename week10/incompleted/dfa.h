@@ -0,0 +1,78 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __DFA_H__
+#define __DFA_H__
+
+#include "charcode.h"
+#include "token.h"
+
+/*
+ * The scanner is a DFA over (state x character class). Each entry gives
+ * the next state and an action; every token, including the two-character
+ * operators, comments and blanks in front of it, is recognised in a single
+ * loop with one table lookup per character.
+ */
+
+enum DfaState {
+  S_START,
+  S_IDENT,
+  S_NUMBER,
+  S_LT,
+  S_GT,
+  S_EXCLAIMATION,
+  S_PERIOD,
+  S_COLON,
+  S_LPAR,
+  S_COMMENT,
+  S_COMMENT_STAR,
+  S_CHAR,
+  S_CHAR_END,
+  DFA_STATES
+};
+
+// Character classes: the CharCode values, then two extra ones
+#define CLASS_UTF8 (CHAR_UNKNOWN + 1)
+#define CLASS_EOF (CHAR_UNKNOWN + 2)
+#define DFA_CLASSES (CHAR_UNKNOWN + 3)
+
+enum DfaAction {
+  A_SKIP,              // consume, no token started
+  A_MARK,              // start a token here, consume
+  A_MARK_LETTER,       // start an identifier with this letter
+  A_MARK_DIGIT,        // start a number with this digit
+  A_LETTER,            // append to the identifier
+  A_DIGIT,             // append to the number
+  A_SINGLE,            // one-character token
+  A_COMPLETE,          // consume the second character and emit
+  A_EMIT,              // emit without consuming the lookahead
+  A_EMIT_IDENT,
+  A_EMIT_NUMBER,
+  A_STORE_CHAR,        // the character of a char constant
+  A_UTF8_CHAR,         // a multi-byte character of a char constant, which
+                       // is rejected once the constant is complete
+  A_UTF8_COMMENT,      // multi-byte text in a comment
+  A_INVALID,           // invalid symbol here
+  A_INVALID_MARK,      // invalid symbol at the token start ('!')
+  A_BAD_CHAR,          // malformed char constant
+  A_BAD_COMMENT,       // end of file inside a comment
+  A_EOF
+};
+
+typedef struct {
+  unsigned char next;
+  unsigned char action;
+  unsigned char tokenType;
+} DfaEntry;
+
+extern DfaEntry dfaTable[DFA_STATES][DFA_CLASSES];
+// Indexed by character + 1 so that EOF needs no test
+extern unsigned char dfaClasses[257];
+
+// Fills the tables, once before any scanning
+void buildDfa(void);
+
+#endif
@@ -0,0 +1,236 @@
+/* Table-driven scanner
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+
+#include "reader.h"
+#include "charcode.h"
+#include "utf8.h"
+#include "token.h"
+#include "error.h"
+#include "scanner.h"
+#include "dfa.h"
+#include "context.h"
+
+extern CharCode charCodes[];
+
+DfaEntry dfaTable[DFA_STATES][DFA_CLASSES];
+// Indexed by currentChar + 1 so that EOF needs no test
+unsigned char dfaClasses[257];
+
+void setDfaRow(int state, int next, int action, TokenType tokenType) {
+  int c;
+  for (c = 0; c < DFA_CLASSES; c++) {
+    dfaTable[state][c].next = next;
+    dfaTable[state][c].action = action;
+    dfaTable[state][c].tokenType = tokenType;
+  }
+}
+
+void setDfaEntry(int state, int charClass, int next, int action, TokenType tokenType) {
+  dfaTable[state][charClass].next = next;
+  dfaTable[state][charClass].action = action;
+  dfaTable[state][charClass].tokenType = tokenType;
+}
+
+void buildDfa(void) {
+  int c;
+
+  dfaClasses[0] = CLASS_EOF;
+  for (c = 0; c < 256; c++)
+    dfaClasses[c + 1] = isUtf8Byte(c) ? CLASS_UTF8 : charCodes[c];
+
+  setDfaRow(S_START, S_START, A_INVALID, TK_NONE);
+  setDfaEntry(S_START, CHAR_SPACE, S_START, A_SKIP, TK_NONE);
+  setDfaEntry(S_START, CHAR_LETTER, S_IDENT, A_MARK_LETTER, TK_NONE);
+  setDfaEntry(S_START, CHAR_DIGIT, S_NUMBER, A_MARK_DIGIT, TK_NONE);
+  setDfaEntry(S_START, CHAR_PLUS, S_START, A_SINGLE, SB_PLUS);
+  setDfaEntry(S_START, CHAR_MINUS, S_START, A_SINGLE, SB_MINUS);
+  setDfaEntry(S_START, CHAR_TIMES, S_START, A_SINGLE, SB_TIMES);
+  setDfaEntry(S_START, CHAR_SLASH, S_START, A_SINGLE, SB_SLASH);
+  setDfaEntry(S_START, CHAR_EQ, S_START, A_SINGLE, SB_EQ);
+  setDfaEntry(S_START, CHAR_COMMA, S_START, A_SINGLE, SB_COMMA);
+  setDfaEntry(S_START, CHAR_SEMICOLON, S_START, A_SINGLE, SB_SEMICOLON);
+  setDfaEntry(S_START, CHAR_RPAR, S_START, A_SINGLE, SB_RPAR);
+  setDfaEntry(S_START, CHAR_LT, S_LT, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_GT, S_GT, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_EXCLAIMATION, S_EXCLAIMATION, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_PERIOD, S_PERIOD, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_COLON, S_COLON, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_LPAR, S_LPAR, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CHAR_SINGLEQUOTE, S_CHAR, A_MARK, TK_NONE);
+  setDfaEntry(S_START, CLASS_EOF, S_START, A_EOF, TK_EOF);
+
+  setDfaRow(S_IDENT, S_START, A_EMIT_IDENT, TK_IDENT);
+  setDfaEntry(S_IDENT, CHAR_LETTER, S_IDENT, A_LETTER, TK_NONE);
+  setDfaEntry(S_IDENT, CHAR_DIGIT, S_IDENT, A_LETTER, TK_NONE);
+
+  setDfaRow(S_NUMBER, S_START, A_EMIT_NUMBER, TK_NUMBER);
+  setDfaEntry(S_NUMBER, CHAR_DIGIT, S_NUMBER, A_DIGIT, TK_NONE);
+
+  setDfaRow(S_LT, S_START, A_EMIT, SB_LT);
+  setDfaEntry(S_LT, CHAR_EQ, S_START, A_COMPLETE, SB_LE);
+
+  setDfaRow(S_GT, S_START, A_EMIT, SB_GT);
+  setDfaEntry(S_GT, CHAR_EQ, S_START, A_COMPLETE, SB_GE);
+
+  setDfaRow(S_EXCLAIMATION, S_START, A_INVALID_MARK, TK_NONE);
+  setDfaEntry(S_EXCLAIMATION, CHAR_EQ, S_START, A_COMPLETE, SB_NEQ);
+
+  setDfaRow(S_PERIOD, S_START, A_EMIT, SB_PERIOD);
+  setDfaEntry(S_PERIOD, CHAR_RPAR, S_START, A_COMPLETE, SB_RSEL);
+
+  setDfaRow(S_COLON, S_START, A_EMIT, SB_COLON);
+  setDfaEntry(S_COLON, CHAR_EQ, S_START, A_COMPLETE, SB_ASSIGN);
+
+  setDfaRow(S_LPAR, S_START, A_EMIT, SB_LPAR);
+  setDfaEntry(S_LPAR, CHAR_PERIOD, S_START, A_COMPLETE, SB_LSEL);
+  setDfaEntry(S_LPAR, CHAR_TIMES, S_COMMENT, A_SKIP, TK_NONE);
+
+  setDfaRow(S_COMMENT, S_COMMENT, A_SKIP, TK_NONE);
+  setDfaEntry(S_COMMENT, CHAR_TIMES, S_COMMENT_STAR, A_SKIP, TK_NONE);
+  setDfaEntry(S_COMMENT, CLASS_UTF8, S_COMMENT, A_UTF8_COMMENT, TK_NONE);
+  setDfaEntry(S_COMMENT, CLASS_EOF, S_COMMENT, A_BAD_COMMENT, TK_NONE);
+
+  setDfaRow(S_COMMENT_STAR, S_COMMENT, A_SKIP, TK_NONE);
+  setDfaEntry(S_COMMENT_STAR, CHAR_TIMES, S_COMMENT_STAR, A_SKIP, TK_NONE);
+  setDfaEntry(S_COMMENT_STAR, CHAR_RPAR, S_START, A_SKIP, TK_NONE);
+  setDfaEntry(S_COMMENT_STAR, CLASS_UTF8, S_COMMENT, A_UTF8_COMMENT, TK_NONE);
+  setDfaEntry(S_COMMENT_STAR, CLASS_EOF, S_COMMENT, A_BAD_COMMENT, TK_NONE);
+
+  setDfaRow(S_CHAR, S_CHAR_END, A_STORE_CHAR, TK_NONE);
+  setDfaEntry(S_CHAR, CLASS_UTF8, S_CHAR_END, A_UTF8_CHAR, TK_NONE);
+  setDfaEntry(S_CHAR, CLASS_EOF, S_START, A_BAD_CHAR, TK_NONE);
+
+  setDfaRow(S_CHAR_END, S_START, A_BAD_CHAR, TK_NONE);
+  setDfaEntry(S_CHAR_END, CHAR_SINGLEQUOTE, S_START, A_COMPLETE, TK_CHAR);
+
+}
+
+Token* getDfaToken(void) {
+  char text[MAX_IDENT_LEN + 2];
+  int count = 0;
+  long long value = 0;
+  int state = S_START;
+  SourcePos start = 0;
+  DfaEntry *entry;
+  Token *token;
+
+  while (1) {
+    entry = &dfaTable[state][dfaClasses[compiler->currentChar + 1]];
+
+    switch (entry->action) {
+    case A_SKIP:
+      readChar();
+      break;
+    case A_MARK:
+      start = currentPos();
+      readChar();
+      break;
+    case A_MARK_LETTER:
+      start = currentPos();
+      text[0] = toupper(compiler->currentChar);
+      count = 1;
+      readChar();
+      break;
+    case A_MARK_DIGIT:
+      start = currentPos();
+      value = compiler->currentChar - '0';
+      readChar();
+      break;
+    case A_LETTER:
+      if (count <= MAX_IDENT_LEN) text[count++] = toupper(compiler->currentChar);
+      readChar();
+      break;
+    case A_DIGIT:
+      if (value <= INT_MAX) value = value * 10 + (compiler->currentChar - '0');
+      readChar();
+      break;
+    case A_STORE_CHAR:
+      text[0] = compiler->currentChar;
+      text[1] = '\0';
+      readChar();
+      break;
+    case A_UTF8_CHAR:
+      if (readUtf8Char(text) == 0) {
+	lexError(ERR_INVALID_CONSTANT_CHAR, start);
+	return makeToken(TK_NONE, start);
+      }
+      break;
+    case A_UTF8_COMMENT:
+      skipUtf8Text();
+      break;
+
+    case A_SINGLE:
+      token = makeToken(entry->tokenType, currentPos());
+      readChar();
+      return token;
+    case A_COMPLETE:
+      readChar();
+      if ((entry->tokenType == TK_CHAR) && isUtf8Byte((unsigned char) text[0])) {
+	lexError(ERR_WIDE_CONSTANT_CHAR, start);
+	return makeToken(TK_NONE, start);
+      }
+      token = makeToken(entry->tokenType, start);
+      if (entry->tokenType == TK_CHAR) {
+	memcpy(token->string, text, sizeof(token->string));
+	token->length = currentPos() - start;
+      }
+      return token;
+    case A_EMIT:
+      return makeToken(entry->tokenType, start);
+    case A_EMIT_IDENT:
+      token = makeToken(TK_NONE, start);
+      if (count > MAX_IDENT_LEN) {
+	lexError(ERR_IDENT_TOO_LONG, start);
+	return token;
+      }
+      text[count] = '\0';
+      token->length = count;
+      token->tokenType = checkKeyword(text);
+      if (token->tokenType == TK_NONE) {
+	token->tokenType = TK_IDENT;
+	token->atom = internName(text, count);
+      }
+      return token;
+    case A_EMIT_NUMBER:
+      token = makeToken(TK_NUMBER, start);
+      if (value > INT_MAX) {
+	token->tokenType = TK_NONE;
+	lexError(ERR_NUMBER_TOO_LARGE, start);
+	return token;
+      }
+      token->length = currentPos() - start;
+      token->value = (int) value;
+      return token;
+    case A_EOF:
+      return makeToken(TK_EOF, currentPos());
+
+    case A_INVALID:
+      token = makeToken(TK_NONE, currentPos());
+      lexError(ERR_INVALID_SYMBOL, currentPos());
+      readChar();
+      return token;
+    case A_INVALID_MARK:
+      token = makeToken(TK_NONE, start);
+      lexError(ERR_INVALID_SYMBOL, start);
+      return token;
+    case A_BAD_CHAR:
+      token = makeToken(TK_NONE, start);
+      lexError(ERR_INVALID_CONSTANT_CHAR, start);
+      return token;
+    case A_BAD_COMMENT:
+      lexError(ERR_END_OF_COMMENT, currentPos());
+      return makeToken(TK_NONE, currentPos());
+    }
+
+    state = entry->next;
+  }
+}
@@ -6,20 +6,24 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "context.h"
 #include "error.h"
 
-#define NUM_OF_ERRORS 29
+#define NUM_OF_ERRORS 32
 
 struct ErrorMessage {
   ErrorCode errorCode;
   char *message;
 };
 
-struct ErrorMessage errors[29] = {
+struct ErrorMessage errors[NUM_OF_ERRORS] = {
   {ERR_END_OF_COMMENT, "End of comment expected."},
   {ERR_IDENT_TOO_LONG, "Identifier too long."},
+  {ERR_NUMBER_TOO_LARGE, "Number too large."},
   {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
   {ERR_INVALID_SYMBOL, "Invalid symbol."},
+  {ERR_INVALID_UTF8, "Invalid UTF-8 sequence."},
+  {ERR_WIDE_CONSTANT_CHAR, "Char constant wider than one byte."},
   {ERR_INVALID_IDENT, "An identifier expected."},
   {ERR_INVALID_CONSTANT, "A constant expected."},
   {ERR_INVALID_TYPE, "A type expected."},
@@ -47,18 +51,36 @@ struct ErrorMessage errors[29] = {
   {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."}
 };
 
-void error(ErrorCode err, int lineNo, int colNo) {
+// The compilation stops at the maxErrors-th error; 0 is no limit
+void countError(void) {
+  compiler->errorCount ++;
+  if ((compiler->maxErrors > 0) && (compiler->errorCount >= compiler->maxErrors))
+    longjmp(compiler->errorExit, 1);
+}
+
+void printPosition(SourcePos pos) {
+  SourcePos lineNo, colNo;
+
+  resolvePosition(pos, &lineNo, &colNo);
+  if (compiler->inputName != NULL) printf("%s:", compiler->inputName);
+  printf("%lld-%lld:", lineNo, colNo);
+}
+
+void error(ErrorCode err, SourcePos pos) {
   int i;
   for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
     if (errors[i].errorCode == err) {
-      printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
+      printPosition(pos);
+      printf("%s\n", errors[i].message);
+      countError();
+      return;
     }
 }
 
-void missingToken(TokenType tokenType, int lineNo, int colNo) {
-  printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
-  exit(0);
+void missingToken(TokenType tokenType, SourcePos pos) {
+  printPosition(pos);
+  printf("Missing %s\n", tokenToString(tokenType));
+  countError();
 }
 
 void assert(char *msg) {
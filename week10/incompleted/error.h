@@ -11,8 +11,11 @@
 typedef enum {
   ERR_END_OF_COMMENT,
   ERR_IDENT_TOO_LONG,
+  ERR_NUMBER_TOO_LARGE,
   ERR_INVALID_CONSTANT_CHAR,
   ERR_INVALID_SYMBOL,
+  ERR_INVALID_UTF8,
+  ERR_WIDE_CONSTANT_CHAR,
   ERR_INVALID_IDENT,
   ERR_INVALID_CONSTANT,
   ERR_INVALID_TYPE,
@@ -40,8 +43,10 @@ typedef enum {
   ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY
 } ErrorCode;
 
-void error(ErrorCode err, int lineNo, int colNo);
-void missingToken(TokenType tokenType, int lineNo, int colNo);
+// Errors are reported as they are found; the maxErrors-th of the
+// CompilerContext ends the compilation, unless maxErrors is 0
+void error(ErrorCode err, SourcePos pos);
+void missingToken(TokenType tokenType, SourcePos pos);
 void assert(char *msg);
 
 #endif
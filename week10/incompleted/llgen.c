@@ -0,0 +1,528 @@
+/* LL(1) parser generator
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+/*
+ * llgen grammar base reads a grammar (see kpl.grammar for the notation)
+ * and writes base.h and base.c: the FIRST and FOLLOW sets of each
+ * nonterminal as TokenSet constants, and the tables llparse.c runs on.
+ * The grammar must be LL(1), but for an empty alternative giving way to
+ * the others; anything else is reported and nothing is written.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#define MAX_NAME_LEN 31
+#define MAX_NAMES 256
+#define MAX_TERMINALS 64        // the bits of a TokenSet
+#define MAX_NONTERMINALS 192    // so that every symbol fits in a byte
+#define MAX_RULES 512
+#define MAX_RHS 16
+#define MAX_INCLUDES 8
+
+// A set of terminals, by their number
+typedef unsigned long long Set;
+
+// Every name in the grammar, with what is known of it
+char names[MAX_NAMES][MAX_NAME_LEN + 1];
+int nameCount = 0;
+int nameRule[MAX_NAMES];        // the rule defining a nonterminal, or -1
+int nameSymbol[MAX_NAMES];      // its terminal or nonterminal number
+char nameError[MAX_NAMES][MAX_NAME_LEN + 1];
+
+// Symbols of the rules are terminal numbers, and TERMINAL_LIMIT + n for
+// nonterminal n, as in the tables written out
+#define TERMINAL_LIMIT MAX_TERMINALS
+
+int terminals[MAX_TERMINALS];   // name of each terminal
+int terminalCount = 0;
+int nonterminals[MAX_NONTERMINALS];
+int nonterminalCount = 0;
+
+// Alternatives of nonterminal n are the rules firstRule[n] up to
+// firstRule[n + 1]; right hand sides hold names until they are resolved
+int ruleLhs[MAX_RULES];
+int ruleRhs[MAX_RULES][MAX_RHS];
+int ruleLength[MAX_RULES];
+int ruleCount = 0;
+int firstRule[MAX_NONTERMINALS + 1];
+
+int nullable[MAX_NONTERMINALS];
+Set first[MAX_NONTERMINALS];
+Set follow[MAX_NONTERMINALS];
+Set predict[MAX_RULES];
+int defaultRule[MAX_NONTERMINALS];
+
+char includes[MAX_INCLUDES][MAX_NAME_LEN + 1];
+int includeCount = 0;
+int endName = -1;
+
+const char *grammarName;
+FILE *grammar;
+int lineNo = 1;
+char word[MAX_NAME_LEN + 1];
+
+void fail(const char *format, ...) {
+  va_list args;
+
+  fprintf(stderr, "%s:%d: ", grammarName, lineNo);
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+int findName(const char *name) {
+  int i;
+
+  for (i = 0; i < nameCount; i ++)
+    if (strcmp(names[i], name) == 0) return i;
+  if (nameCount == MAX_NAMES)
+    fail("too many names");
+  strcpy(names[nameCount], name);
+  nameRule[nameCount] = -1;
+  nameError[nameCount][0] = '\0';
+  return nameCount ++;
+}
+
+/******************************************************************/
+
+// Reads the next item of the grammar: a name or a directive into word,
+// returning 'a' or '%', a quoted string into word, returning '"', or
+// a single character; EOF at the end
+int readItem(void) {
+  int c, n = 0;
+
+  while (1) {
+    c = getc(grammar);
+    if (c == '#')
+      while ((c != '\n') && (c != EOF)) c = getc(grammar);
+    if (c == '\n') lineNo ++;
+    else if ((c == EOF) || !isspace(c)) break;
+  }
+
+  if (c == '"') {
+    while (((c = getc(grammar)) != '"') && (c != '\n') && (c != EOF))
+      if (n < MAX_NAME_LEN) word[n++] = c;
+    if (c != '"') fail("unterminated string");
+    word[n] = '\0';
+    return '"';
+  }
+  if ((c == '%') || isalpha(c) || (c == '_')) {
+    int kind = (c == '%') ? '%' : 'a';
+    if (kind == 'a') word[n++] = c;
+    while (isalnum(c = getc(grammar)) || (c == '_'))
+      if (n < MAX_NAME_LEN) word[n++] = c;
+      else fail("name too long");
+    ungetc(c, grammar);
+    word[n] = '\0';
+    return kind;
+  }
+  return c;
+}
+
+void expectName(void) {
+  if (readItem() != 'a') fail("name expected");
+}
+
+void readDirective(void) {
+  int name;
+
+  if (strcmp(word, "include") == 0) {
+    if (readItem() != '"') fail("file name expected");
+    if (includeCount == MAX_INCLUDES) fail("too many includes");
+    strcpy(includes[includeCount++], word);
+  } else if (strcmp(word, "end") == 0) {
+    expectName();
+    endName = findName(word);
+  } else if (strcmp(word, "error") == 0) {
+    expectName();
+    name = findName(word);
+    expectName();
+    strcpy(nameError[name], word);
+  } else fail("unknown directive %%%s", word);
+}
+
+// name : alternative | alternative ... ;
+void readRule(void) {
+  int lhs = findName(word);
+  int item;
+
+  if (nameRule[lhs] >= 0)
+    fail("%s is defined twice", names[lhs]);
+  if (nonterminalCount == MAX_NONTERMINALS)
+    fail("too many nonterminals");
+  nameRule[lhs] = ruleCount;
+  nameSymbol[lhs] = nonterminalCount;
+  nonterminals[nonterminalCount] = lhs;
+  firstRule[nonterminalCount++] = ruleCount;
+  if (readItem() != ':') fail("':' expected after %s", names[lhs]);
+
+  do {
+    if (ruleCount == MAX_RULES) fail("too many rules");
+    ruleLhs[ruleCount] = nameSymbol[lhs];
+    ruleLength[ruleCount] = 0;
+    while ((item = readItem()) == 'a') {
+      if (ruleLength[ruleCount] == MAX_RHS) fail("alternative too long");
+      ruleRhs[ruleCount][ruleLength[ruleCount]++] = findName(word);
+    }
+    ruleCount ++;
+  } while (item == '|');
+  if (item != ';') fail("';' expected");
+}
+
+void readGrammar(void) {
+  int item;
+
+  while ((item = readItem()) != EOF) {
+    if (item == '%') readDirective();
+    else if (item == 'a') readRule();
+    else fail("unexpected '%c'", item);
+  }
+  firstRule[nonterminalCount] = ruleCount;
+  if (nonterminalCount == 0) fail("no rules");
+  if (endName < 0) fail("no %%end token");
+}
+
+int terminalNumber(int name) {
+  int i;
+
+  for (i = 0; i < terminalCount; i ++)
+    if (terminals[i] == name) return i;
+  if (terminalCount == MAX_TERMINALS)
+    fail("too many terminals");
+  terminals[terminalCount] = name;
+  return terminalCount ++;
+}
+
+// Turns the names of the right hand sides into symbols
+void resolveSymbols(void) {
+  int r, i, name;
+
+  for (r = 0; r < ruleCount; r ++)
+    for (i = 0; i < ruleLength[r]; i ++) {
+      name = ruleRhs[r][i];
+      if (nameRule[name] >= 0)
+	ruleRhs[r][i] = TERMINAL_LIMIT + nameSymbol[name];
+      else ruleRhs[r][i] = terminalNumber(name);
+    }
+  terminalNumber(endName);
+
+  for (i = 0; i < nameCount; i ++)
+    if ((nameError[i][0] != '\0') && (nameRule[i] < 0))
+      fail("%%error for %s, which is not a nonterminal", names[i]);
+}
+
+/******************************************************************/
+
+// FIRST of symbols from..length of rule r; sets *empty when they can all
+// derive the empty string
+Set sequenceFirst(int r, int from, int *empty) {
+  Set set = 0;
+  int i, s;
+
+  for (i = from; i < ruleLength[r]; i ++) {
+    s = ruleRhs[r][i];
+    if (s < TERMINAL_LIMIT) {
+      *empty = 0;
+      return set | (1ULL << s);
+    }
+    set |= first[s - TERMINAL_LIMIT];
+    if (!nullable[s - TERMINAL_LIMIT]) {
+      *empty = 0;
+      return set;
+    }
+  }
+  *empty = 1;
+  return set;
+}
+
+void computeSets(void) {
+  int changed = 1;
+  int r, i, s, n, empty;
+  Set set;
+
+  while (changed) {
+    changed = 0;
+    for (r = 0; r < ruleCount; r ++) {
+      n = ruleLhs[r];
+      set = first[n] | sequenceFirst(r, 0, &empty);
+      if ((set != first[n]) || (empty && !nullable[n])) changed = 1;
+      first[n] = set;
+      if (empty) nullable[n] = 1;
+    }
+  }
+
+  follow[0] = 1ULL << terminalNumber(endName);
+  changed = 1;
+  while (changed) {
+    changed = 0;
+    for (r = 0; r < ruleCount; r ++)
+      for (i = 0; i < ruleLength[r]; i ++) {
+	s = ruleRhs[r][i];
+	if (s < TERMINAL_LIMIT) continue;
+	n = s - TERMINAL_LIMIT;
+	set = follow[n] | sequenceFirst(r, i + 1, &empty);
+	if (empty) set |= follow[ruleLhs[r]];
+	if (set != follow[n]) changed = 1;
+	follow[n] = set;
+      }
+  }
+}
+
+// Lowest terminal in a set
+const char *someTerminal(Set set) {
+  int t = 0;
+
+  while (!(set & (1ULL << t))) t ++;
+  return names[terminals[t]];
+}
+
+// Predicts each alternative, checking the grammar is LL(1). An empty
+// alternative gives way to the others where their FIRST sets meet its
+// FOLLOW set.
+void computePredict(void) {
+  int n, r, s, empty;
+  Set other;
+  Set firsts[MAX_RULES];
+  int emptyRule;
+
+  for (n = 0; n < nonterminalCount; n ++) {
+    emptyRule = -1;
+    for (r = firstRule[n]; r < firstRule[n + 1]; r ++) {
+      firsts[r] = sequenceFirst(r, 0, &empty);
+      predict[r] = firsts[r];
+      if (!empty) continue;
+      if (emptyRule >= 0)
+	fail("%s: alternatives %d and %d can both be empty", names[nonterminals[n]],
+	     emptyRule - firstRule[n] + 1, r - firstRule[n] + 1);
+      emptyRule = r;
+      predict[r] |= follow[n];
+    }
+
+    for (r = firstRule[n]; r < firstRule[n + 1]; r ++)
+      for (s = r + 1; s < firstRule[n + 1]; s ++)
+	if (firsts[r] & firsts[s])
+	  fail("%s is not LL(1): alternatives %d and %d both start with %s",
+	       names[nonterminals[n]], r - firstRule[n] + 1, s - firstRule[n] + 1,
+	       someTerminal(firsts[r] & firsts[s]));
+
+    if (emptyRule >= 0) {
+      other = 0;
+      for (r = firstRule[n]; r < firstRule[n + 1]; r ++)
+	if (r != emptyRule) other |= firsts[r];
+      predict[emptyRule] &= ~other;
+    }
+
+    // On any other token the %error is reported; without one the empty
+    // alternative is taken, or else the last
+    if (nameError[nonterminals[n]][0] != '\0')
+      defaultRule[n] = -1;
+    else if (emptyRule >= 0)
+      defaultRule[n] = emptyRule;
+    else defaultRule[n] = firstRule[n + 1] - 1;
+  }
+}
+
+/******************************************************************/
+
+void writeSet(FILE *out, Set set) {
+  int t, count = 0;
+
+  if (set == 0) {
+    fprintf(out, "0");
+    return;
+  }
+  fprintf(out, "(");
+  for (t = 0; t < terminalCount; t ++)
+    if (set & (1ULL << t)) {
+      if (count > 0) fprintf(out, (count % 4 == 0) ? " | \\\n   " : " | ");
+      fprintf(out, "TOKEN_BIT(%s)", names[terminals[t]]);
+      count ++;
+    }
+  fprintf(out, ")");
+}
+
+void writeTableSet(FILE *out, Set set) {
+  int t, count = 0;
+
+  if (set == 0) {
+    fprintf(out, "  0,\n");
+    return;
+  }
+  for (t = 0; t < terminalCount; t ++)
+    if (set & (1ULL << t)) {
+      fprintf(out, (count == 0) ? "  " : (count % 4 == 0) ? " |\n    " : " | ");
+      fprintf(out, "TOKEN_BIT(%s)", names[terminals[t]]);
+      count ++;
+    }
+  fprintf(out, ",\n");
+}
+
+void writeHeader(FILE *out, const char *base) {
+  const char *slash = strrchr(base, '/');
+  const char *p;
+  int n;
+
+  fprintf(out, "/* Generated by llgen from %s: do not edit */\n\n", grammarName);
+  fprintf(out, "#ifndef __");
+  for (p = (slash != NULL) ? slash + 1 : base; *p != '\0'; p ++)
+    fputc(isalnum(*p) ? toupper(*p) : '_', out);
+  fprintf(out, "_H__\n#define __");
+  for (p = (slash != NULL) ? slash + 1 : base; *p != '\0'; p ++)
+    fputc(isalnum(*p) ? toupper(*p) : '_', out);
+  fprintf(out, "_H__\n\n#include \"token.h\"\n\n");
+
+  fprintf(out, "enum Nonterminal {\n");
+  for (n = 0; n < nonterminalCount; n ++)
+    fprintf(out, "  NT_%s,\n", names[nonterminals[n]]);
+  fprintf(out, "  NONTERMINALS\n};\n\n");
+
+  fprintf(out, "// The tokens each nonterminal can start with, and those that can follow it\n");
+  for (n = 0; n < nonterminalCount; n ++) {
+    fprintf(out, "#define FIRST_%s ", names[nonterminals[n]]);
+    writeSet(out, first[n]);
+    fprintf(out, "\n#define FOLLOW_%s ", names[nonterminals[n]]);
+    writeSet(out, follow[n]);
+    fprintf(out, "\n");
+  }
+
+  fprintf(out, "\n// Symbols from LL_NONTERMINAL on are nonterminals; nonterminal n has\n");
+  fprintf(out, "// the rules llFirstRule[n] up to llFirstRule[n + 1], and rule r the\n");
+  fprintf(out, "// symbols llSymbols[llRuleStart[r]] up to llSymbols[llRuleStart[r + 1]]\n");
+  fprintf(out, "#define LL_NONTERMINAL %d\n", TERMINAL_LIMIT);
+  fprintf(out, "#define LL_RULES %d\n\n", ruleCount);
+  fprintf(out, "extern const unsigned char llSymbols[];\n");
+  fprintf(out, "extern const unsigned short llRuleStart[LL_RULES + 1];\n");
+  fprintf(out, "extern const unsigned short llFirstRule[NONTERMINALS + 1];\n");
+  fprintf(out, "// The tokens on which each rule is taken\n");
+  fprintf(out, "extern const TokenSet llPredict[LL_RULES];\n");
+  fprintf(out, "// The rule taken on any other token, or -1 to report llError\n");
+  fprintf(out, "extern const short llDefaultRule[NONTERMINALS];\n");
+  fprintf(out, "extern const short llError[NONTERMINALS];\n");
+  fprintf(out, "extern const TokenSet llFirst[NONTERMINALS];\n");
+  fprintf(out, "extern const TokenSet llFollow[NONTERMINALS];\n\n");
+  fprintf(out, "#endif\n");
+}
+
+void writeTables(FILE *out, const char *base) {
+  const char *slash = strrchr(base, '/');
+  int n, r, i, s, start;
+
+  fprintf(out, "/* Generated by llgen from %s: do not edit */\n\n", grammarName);
+  for (i = 0; i < includeCount; i ++)
+    fprintf(out, "#include \"%s\"\n", includes[i]);
+  fprintf(out, "#include \"%s.h\"\n\n", (slash != NULL) ? slash + 1 : base);
+
+  fprintf(out, "const unsigned char llSymbols[] = {\n");
+  for (r = 0; r < ruleCount; r ++) {
+    fprintf(out, "  // %s :", names[nonterminals[ruleLhs[r]]]);
+    if (ruleLength[r] == 0) fprintf(out, " (empty)");
+    for (i = 0; i < ruleLength[r]; i ++) {
+      s = ruleRhs[r][i];
+      fprintf(out, " %s", (s < TERMINAL_LIMIT) ? names[terminals[s]] : names[nonterminals[s - TERMINAL_LIMIT]]);
+    }
+    fprintf(out, "\n");
+    for (i = 0; i < ruleLength[r]; i ++) {
+      s = ruleRhs[r][i];
+      fprintf(out, (i == 0) ? "  " : (i % 4 == 0) ? "\n  " : " ");
+      if (s < TERMINAL_LIMIT)
+	fprintf(out, "%s,", names[terminals[s]]);
+      else fprintf(out, "LL_NONTERMINAL + NT_%s,", names[nonterminals[s - TERMINAL_LIMIT]]);
+    }
+    if (ruleLength[r] > 0) fprintf(out, "\n");
+  }
+  fprintf(out, "  0\n};\n\n");
+
+  fprintf(out, "const unsigned short llRuleStart[LL_RULES + 1] = {\n ");
+  start = 0;
+  for (r = 0; r <= ruleCount; r ++) {
+    fprintf(out, " %d,", start);
+    if ((r % 12 == 11) && (r < ruleCount)) fprintf(out, "\n ");
+    if (r < ruleCount) start += ruleLength[r];
+  }
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "const unsigned short llFirstRule[NONTERMINALS + 1] = {\n ");
+  for (n = 0; n <= nonterminalCount; n ++) {
+    fprintf(out, " %d,", firstRule[n]);
+    if ((n % 12 == 11) && (n < nonterminalCount)) fprintf(out, "\n ");
+  }
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "const TokenSet llPredict[LL_RULES] = {\n");
+  for (r = 0; r < ruleCount; r ++)
+    writeTableSet(out, predict[r]);
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const short llDefaultRule[NONTERMINALS] = {\n");
+  for (n = 0; n < nonterminalCount; n ++)
+    fprintf(out, "  %d,\t// %s\n", defaultRule[n], names[nonterminals[n]]);
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const short llError[NONTERMINALS] = {\n");
+  for (n = 0; n < nonterminalCount; n ++)
+    if (nameError[nonterminals[n]][0] == '\0')
+      fprintf(out, "  -1,\t// %s\n", names[nonterminals[n]]);
+    else fprintf(out, "  %s,\n", nameError[nonterminals[n]]);
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const TokenSet llFirst[NONTERMINALS] = {\n");
+  for (n = 0; n < nonterminalCount; n ++)
+    fprintf(out, "  FIRST_%s,\n", names[nonterminals[n]]);
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "const TokenSet llFollow[NONTERMINALS] = {\n");
+  for (n = 0; n < nonterminalCount; n ++)
+    fprintf(out, "  FOLLOW_%s,\n", names[nonterminals[n]]);
+  fprintf(out, "};\n");
+}
+
+FILE *createOutput(const char *base, const char *suffix) {
+  char fileName[1024];
+  FILE *out;
+
+  snprintf(fileName, sizeof(fileName), "%s%s", base, suffix);
+  out = fopen(fileName, "w");
+  if (out == NULL) {
+    fprintf(stderr, "llgen: cannot write %s\n", fileName);
+    exit(1);
+  }
+  return out;
+}
+
+int main(int argc, char *argv[]) {
+  FILE *out;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: llgen grammar base\n");
+    return 1;
+  }
+  grammarName = argv[1];
+  grammar = fopen(grammarName, "r");
+  if (grammar == NULL) {
+    fprintf(stderr, "llgen: cannot read %s\n", grammarName);
+    return 1;
+  }
+  readGrammar();
+  fclose(grammar);
+
+  resolveSymbols();
+  computeSets();
+  computePredict();
+
+  out = createOutput(argv[2], ".h");
+  writeHeader(out, argv[2]);
+  fclose(out);
+  out = createOutput(argv[2], ".c");
+  writeTables(out, argv[2]);
+  fclose(out);
+  return 0;
+}
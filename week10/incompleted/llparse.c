@@ -0,0 +1,62 @@
+/* Table-driven parser
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+
+#include "parser.h"
+#include "error.h"
+#include "kplgram.h"
+#include "llparse.h"
+#include "context.h"
+
+void reserveStack(int size) {
+  if (size <= compiler->llStackSize)
+    return;
+  while (compiler->llStackSize < size)
+    compiler->llStackSize = (compiler->llStackSize == 0) ? 256 : compiler->llStackSize * 2;
+  compiler->llStack = (unsigned char*) realloc(compiler->llStack, compiler->llStackSize);
+}
+
+void checkSyntax(void) {
+  int top = 0;
+  int symbol, nonterminal, rule, i;
+  TokenType tokenType;
+
+  reserveStack(1);
+  compiler->llStack[top++] = LL_NONTERMINAL + NT_Program;
+
+  while (top > 0) {
+    symbol = compiler->llStack[--top];
+    if (symbol < LL_NONTERMINAL) {
+      eat((TokenType) symbol);
+      continue;
+    }
+
+    nonterminal = symbol - LL_NONTERMINAL;
+    tokenType = compiler->lookAhead->tokenType;
+    for (rule = llFirstRule[nonterminal]; rule < llFirstRule[nonterminal + 1]; rule ++)
+      if (inTokenSet(llPredict[rule], tokenType)) break;
+
+    if (rule == llFirstRule[nonterminal + 1]) {
+      rule = llDefaultRule[nonterminal];
+      if (rule < 0) {
+	// Panic mode, as in the hand written parser: skip to a token the
+	// nonterminal starts with and try it again, or to one that follows
+	// it and leave it out
+	syntaxError((ErrorCode) llError[nonterminal], compiler->lookAhead->offset);
+	while (!inTokenSet(llFirst[nonterminal] | llFollow[nonterminal], compiler->lookAhead->tokenType)
+	       && skipToken()) ;
+	if (inTokenSet(llFirst[nonterminal], compiler->lookAhead->tokenType))
+	  top ++;
+	continue;
+      }
+    }
+
+    reserveStack(top + llRuleStart[rule + 1] - llRuleStart[rule]);
+    for (i = llRuleStart[rule + 1] - 1; i >= llRuleStart[rule]; i --)
+      compiler->llStack[top++] = llSymbols[i];
+  }
+}
@@ -0,0 +1,15 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __LLPARSE_H__
+#define __LLPARSE_H__
+
+// Checks the syntax of the input with the LL(1) tables llgen builds from
+// kpl.grammar, on an explicit stack; neither the symbol table nor the
+// syntax tree is built
+void checkSyntax(void);
+
+#endif
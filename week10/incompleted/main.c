@@ -6,19 +6,69 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "reader.h"
 #include "parser.h"
+#include "error.h"
+#include "context.h"
 
 /******************************************************************/
 
 int main(int argc, char *argv[]) {
-  if (argc <= 1) {
+  CompilerContext *context = createCompiler();
+  int arg = 1;
+  int result;
+
+  // -b: tokenize the whole input before parsing
+  // -j n: the same, on n threads
+  // -c dir: the same, keeping the tokens in a cache in dir
+  // -C dir: as -c, but scan anyway and check the cache
+  // -t: print the syntax tree
+  // -g: only check the syntax, with the generated LL(1) tables
+  // -e n: stop at the n-th error rather than the first, 0 for never
+  // -o: outline, skipping the bodies
+  // -p name: the same, then compile the bodies of name
+  while ((argc > arg) && (argv[arg][0] == '-')) {
+    if (strcmp(argv[arg], "-b") == 0) {
+      context->preTokenize = 1;
+      arg ++;
+    } else if ((strcmp(argv[arg], "-e") == 0) && (argc > arg + 1)) {
+      context->maxErrors = atoi(argv[arg + 1]);
+      arg += 2;
+    } else if (strcmp(argv[arg], "-g") == 0) {
+      context->checkSyntaxOnly = 1;
+      arg ++;
+    } else if (strcmp(argv[arg], "-o") == 0) {
+      context->outline = 1;
+      arg ++;
+    } else if ((strcmp(argv[arg], "-p") == 0) && (argc > arg + 1)) {
+      context->outline = 1;
+      context->outlineBody = argv[arg + 1];
+      arg += 2;
+    } else if (strcmp(argv[arg], "-t") == 0) {
+      context->printTree = 1;
+      arg ++;
+    } else if ((strcmp(argv[arg], "-j") == 0) && (argc > arg + 1)) {
+      context->preTokenize = 1;
+      context->lexThreads = atoi(argv[arg + 1]);
+      arg += 2;
+    } else if (((strcmp(argv[arg], "-c") == 0) || (strcmp(argv[arg], "-C") == 0)) && (argc > arg + 1)) {
+      context->preTokenize = 1;
+      context->validateCache = (argv[arg][1] == 'C');
+      context->tokenCacheDir = argv[arg + 1];
+      arg += 2;
+    } else break;
+  }
+
+  if (argc <= arg) {
     printf("parser: no input file.\n");
     return -1;
   }
 
-  if (compile(argv[1]) == IO_ERROR) {
+  result = compile(context, argv[arg]);
+  freeCompiler(context);
+  if (result == IO_ERROR) {
     printf("Can\'t read input file!\n");
     return -1;
   }
@@ -5,47 +5,121 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "reader.h"
+#include "context.h"
 #include "scanner.h"
+#include "tokbuf.h"
+#include "plex.h"
+#include "tkcache.h"
 #include "parser.h"
+#include "ast.h"
 #include "semantics.h"
 #include "error.h"
 #include "debug.h"
+#include "kplgram.h"
+#include "llparse.h"
+
+Token* readToken(void) {
+  TokenBuffer *tokens = &compiler->unitTokens;
+
+  if (!compiler->preTokenize)
+    return getValidToken();
+  // Lexical errors are reported as they are reached, in the same order as
+  // when scanning on demand
+  while (tokens->types[compiler->tokenIndex] == TK_NONE) {
+    error((ErrorCode) tokens->payloads[compiler->tokenIndex].value, tokens->offsets[compiler->tokenIndex]);
+    compiler->tokenIndex ++;
+  }
+  // the final TK_EOF is handed out again past the end
+  if (compiler->tokenIndex < tokens->count - 1)
+    return bufferedToken(tokens, compiler->tokenIndex++);
+  return bufferedToken(tokens, tokens->count - 1);
+}
 
-Token *currentToken;
-Token *lookAhead;
+Token* nextToken(void) {
+  Token *token;
 
-extern Type* intType;
-extern Type* charType;
-extern SymTab* symtab;
+  if (compiler->ringCount == 0)
+    return readToken();
+  token = compiler->lookAheadRing[compiler->ringFirst];
+  compiler->ringFirst = (compiler->ringFirst + 1) % MAX_LOOKAHEAD;
+  compiler->ringCount --;
+  return token;
+}
+
+Token* peekToken(int k) {
+  if (k <= 1)
+    return compiler->lookAhead;
+  if (k > MAX_LOOKAHEAD + 1)
+    k = MAX_LOOKAHEAD + 1;
+  while (compiler->ringCount < k - 1) {
+    compiler->lookAheadRing[(compiler->ringFirst + compiler->ringCount) % MAX_LOOKAHEAD] = readToken();
+    compiler->ringCount ++;
+  }
+  return compiler->lookAheadRing[(compiler->ringFirst + k - 2) % MAX_LOOKAHEAD];
+}
 
 void scan(void) {
-  Token* tmp = currentToken;
-  currentToken = lookAhead;
-  lookAhead = getValidToken();
-  free(tmp);
+  Token* tmp = compiler->currentToken;
+  compiler->currentToken = compiler->lookAhead;
+  compiler->lookAhead = nextToken();
+  if (tmp != NULL) freeToken(tmp);
+}
+
+/*
+ * Panic mode recovery. A missing token is reported and taken as present;
+ * a production that cannot go on reports the error and skips tokens until
+ * one in its FIRST or FOLLOW set. Until a token is eaten again, further
+ * syntax errors are most likely caused by the first one and are not
+ * reported; panicking is set meanwhile.
+ */
+void syntaxError(ErrorCode err, SourcePos pos) {
+  if (!compiler->panicking)
+    error(err, pos);
+  compiler->panicking = 1;
+}
+
+int skipToken(void) {
+  if (compiler->lookAhead->tokenType == TK_EOF)
+    return 0;
+  scan();
+  return 1;
 }
 
 void eat(TokenType tokenType) {
-  if (lookAhead->tokenType == tokenType) {
+  if (compiler->lookAhead->tokenType == tokenType) {
     scan();
-  } else missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
+    compiler->panicking = 0;
+  } else {
+    if (!compiler->panicking)
+      missingToken(tokenType, compiler->lookAhead->offset);
+    compiler->panicking = 1;
+    // The missing token stands as currentToken, with an empty payload: an
+    // identifier with no name, 0, or an empty char
+    if (compiler->currentToken != NULL) freeToken(compiler->currentToken);
+    compiler->currentToken = makeToken(tokenType, compiler->lookAhead->offset);
+    compiler->currentToken->value = 0;
+  }
 }
 
 void compileProgram(void) {
   Object* program;
+  NodeId node;
 
+  node = beginNode(N_PROGRAM, compiler->lookAhead->offset);
   eat(KW_PROGRAM);
   eat(TK_IDENT);
 
-  program = createProgramObject(currentToken->string);
+  nodePayload(node)->name = compiler->currentToken->atom;
+  program = createProgramObject(compiler->currentToken->atom);
   enterBlock(program->progAttrs->scope);
 
   eat(SB_SEMICOLON);
 
   compileBlock();
   eat(SB_PERIOD);
+  endNode();
 
   exitBlock();
 }
@@ -54,50 +128,56 @@ void compileBlock(void) {
   Object* constObj;
   ConstantValue* constValue;
 
-  if (lookAhead->tokenType == KW_CONST) {
+  beginNode(N_BLOCK, compiler->lookAhead->offset);
+  if (compiler->lookAhead->tokenType == KW_CONST) {
     eat(KW_CONST);
 
     do {
       eat(TK_IDENT);
       
-      checkFreshIdent(currentToken->string);
-      constObj = createConstantObject(currentToken->string);
+      checkFreshIdent(compiler->currentToken->atom);
+      constObj = createConstantObject(compiler->currentToken->atom);
+      nodePayload(beginNode(N_CONST_DECL, compiler->currentToken->offset))->name = compiler->currentToken->atom;
       
       eat(SB_EQ);
       constValue = compileConstant();
+      endNode();
       
       constObj->constAttrs->value = constValue;
       declareObject(constObj);
       
       eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+    } while (compiler->lookAhead->tokenType == TK_IDENT);
 
     compileBlock2();
   } 
   else compileBlock2();
+  endNode();
 }
 
 void compileBlock2(void) {
   Object* typeObj;
   Type* actualType;
 
-  if (lookAhead->tokenType == KW_TYPE) {
+  if (compiler->lookAhead->tokenType == KW_TYPE) {
     eat(KW_TYPE);
 
     do {
       eat(TK_IDENT);
       
-      checkFreshIdent(currentToken->string);
-      typeObj = createTypeObject(currentToken->string);
+      checkFreshIdent(compiler->currentToken->atom);
+      typeObj = createTypeObject(compiler->currentToken->atom);
+      nodePayload(beginNode(N_TYPE_DECL, compiler->currentToken->offset))->name = compiler->currentToken->atom;
       
       eat(SB_EQ);
       actualType = compileType();
+      endNode();
       
       typeObj->typeAttrs->actualType = actualType;
       declareObject(typeObj);
       
       eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+    } while (compiler->lookAhead->tokenType == TK_IDENT);
 
     compileBlock3();
   } 
@@ -108,23 +188,25 @@ void compileBlock3(void) {
   Object* varObj;
   Type* varType;
 
-  if (lookAhead->tokenType == KW_VAR) {
+  if (compiler->lookAhead->tokenType == KW_VAR) {
     eat(KW_VAR);
 
     do {
       eat(TK_IDENT);
       
-      checkFreshIdent(currentToken->string);
-      varObj = createVariableObject(currentToken->string);
+      checkFreshIdent(compiler->currentToken->atom);
+      varObj = createVariableObject(compiler->currentToken->atom);
+      nodePayload(beginNode(N_VAR_DECL, compiler->currentToken->offset))->name = compiler->currentToken->atom;
 
       eat(SB_COLON);
       varType = compileType();
+      endNode();
       
       varObj->varAttrs->type = varType;
       declareObject(varObj);
       
       eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+    } while (compiler->lookAhead->tokenType == TK_IDENT);
 
     compileBlock4();
   } 
@@ -136,15 +218,128 @@ void compileBlock4(void) {
   compileBlock5();
 }
 
+// Index of the END that closes a BEGIN before from, or of the final
+// TK_EOF if there is none
+long matchingEnd(TokenBuffer *tokens, long from) {
+  long i;
+  int depth = 1;
+
+  for (i = from; i < tokens->count - 1; i ++)
+    if (tokens->types[i] == KW_BEGIN)
+      depth ++;
+    else if ((tokens->types[i] == KW_END) && (-- depth == 0))
+      break;
+  return i;
+}
+
+/*
+ * Outline mode: the body is recorded and passed over by matching BEGIN
+ * and END, the only pair that nests in KPL, without looking at the
+ * statements. With preTokenize the END is looked for in the token buffer,
+ * and in a source held in memory it is looked for in the text, so that
+ * the tokens up to it are never built.
+ */
+void skipBody(void) {
+  SkippedBody *body;
+  int depth = 1;
+
+  if (compiler->bodyCount == compiler->bodyCapacity) {
+    compiler->bodyCapacity = (compiler->bodyCapacity == 0) ? 64 : compiler->bodyCapacity * 2;
+    compiler->bodies = (SkippedBody*) realloc(compiler->bodies, compiler->bodyCapacity * sizeof(SkippedBody));
+  }
+  body = &compiler->bodies[compiler->bodyCount];
+  body->scope = compiler->symtab->currentScope;
+  body->from = compiler->lookAhead->offset;
+  body->tokenIndex = compiler->preTokenize ? findToken(&compiler->unitTokens, body->from) : 0;
+  body->node = addNode(N_BODY, body->from);
+  body->compiled = 0;
+  nodePayload(body->node)->value = compiler->bodyCount ++;
+
+  eat(KW_BEGIN);
+  if (compiler->preTokenize) {
+    compiler->tokenIndex = matchingEnd(&compiler->unitTokens,
+				       findToken(&compiler->unitTokens, compiler->lookAhead->offset));
+    freeToken(compiler->lookAhead);
+    while (compiler->ringCount > 0)
+      freeToken(nextToken());
+    compiler->lookAhead = readToken();
+  } else
+    while (compiler->lookAhead->tokenType != TK_EOF) {
+      if (compiler->lookAhead->tokenType == KW_BEGIN)
+	depth ++;
+      else if ((compiler->lookAhead->tokenType == KW_END) && (-- depth == 0))
+	break;
+      if (sourceResident() && (compiler->ringCount == 0)) {
+	skipBlockText(depth);
+	depth = 1;
+	freeToken(compiler->lookAhead);
+	compiler->lookAhead = readToken();
+      } else scan();
+    }
+  eat(KW_END);
+  // END is three bytes in any case
+  body->to = compiler->currentToken->offset + 3;
+}
+
 void compileBlock5(void) {
+  if (compiler->outline) {
+    skipBody();
+    return;
+  }
+  beginNode(N_GROUP, compiler->lookAhead->offset);
+  eat(KW_BEGIN);
+  compileStatements();
+  eat(KW_END);
+  endNode();
+}
+
+int compileBody(SkippedBody *body) {
+  Scope* scope = compiler->symtab->currentScope;
+
+  if (body->compiled)
+    return IO_SUCCESS;
+  if (!compiler->preTokenize && !sourceResident())
+    return IO_ERROR;
+
+  // Go back to the BEGIN
+  freeToken(compiler->lookAhead);
+  while (compiler->ringCount > 0)
+    freeToken(nextToken());
+  if (compiler->preTokenize)
+    compiler->tokenIndex = body->tokenIndex;
+  else advanceTo(compiler->inputStart + (body->from - compiler->inputBase));
+  compiler->lookAhead = readToken();
+  compiler->panicking = 0;
+
+  enterBlock(body->scope);
+  reopenNode(body->node, N_GROUP);
   eat(KW_BEGIN);
   compileStatements();
   eat(KW_END);
+  endNode();
+  enterBlock(scope);
+
+  body->compiled = 1;
+  return IO_SUCCESS;
+}
+
+// Compiles the bodies of the program, functions and procedures named
+// outlineBody
+void compileOutlineBodies(void) {
+  Atom name = internSpan((const unsigned char*) compiler->outlineBody, strlen(compiler->outlineBody));
+  int i;
+
+  for (i = 0; i < compiler->bodyCount; i ++)
+    if (compiler->bodies[i].scope->owner->name == name)
+      if (compileBody(&compiler->bodies[i]) == IO_ERROR) {
+	printf("Can\'t go back to the body of %s!\n", atomName(name));
+	return;
+      }
 }
 
 void compileSubDecls(void) {
-  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE)) {
-    if (lookAhead->tokenType == KW_FUNCTION)
+  while ((compiler->lookAhead->tokenType == KW_FUNCTION) || (compiler->lookAhead->tokenType == KW_PROCEDURE)) {
+    if (compiler->lookAhead->tokenType == KW_FUNCTION)
       compileFuncDecl();
     else compileProcDecl();
   }
@@ -153,12 +348,15 @@ void compileSubDecls(void) {
 void compileFuncDecl(void) {
   Object* funcObj;
   Type* returnType;
+  NodeId node;
 
+  node = beginNode(N_FUNC_DECL, compiler->lookAhead->offset);
   eat(KW_FUNCTION);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  funcObj = createFunctionObject(currentToken->string);
+  nodePayload(node)->name = compiler->currentToken->atom;
+  checkFreshIdent(compiler->currentToken->atom);
+  funcObj = createFunctionObject(compiler->currentToken->atom);
   declareObject(funcObj);
 
   enterBlock(funcObj->funcAttrs->scope);
@@ -172,18 +370,22 @@ void compileFuncDecl(void) {
   eat(SB_SEMICOLON);
   compileBlock();
   eat(SB_SEMICOLON);
+  endNode();
 
   exitBlock();
 }
 
 void compileProcDecl(void) {
   Object* procObj;
+  NodeId node;
 
+  node = beginNode(N_PROC_DECL, compiler->lookAhead->offset);
   eat(KW_PROCEDURE);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  procObj = createProcedureObject(currentToken->string);
+  nodePayload(node)->name = compiler->currentToken->atom;
+  checkFreshIdent(compiler->currentToken->atom);
+  procObj = createProcedureObject(compiler->currentToken->atom);
   declareObject(procObj);
 
   enterBlock(procObj->procAttrs->scope);
@@ -193,32 +395,42 @@ void compileProcDecl(void) {
   eat(SB_SEMICOLON);
   compileBlock();
   eat(SB_SEMICOLON);
+  endNode();
 
   exitBlock();
 }
 
+// The char constant just eaten
+void addCharNode(void) {
+  memcpy(nodePayload(addNode(N_CHAR, compiler->currentToken->offset))->text, compiler->currentToken->string, sizeof(compiler->currentToken->string));
+}
+
 ConstantValue* compileUnsignedConstant(void) {
   ConstantValue* constValue;
   Object* obj;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    constValue = makeIntConstant(currentToken->value);
+    nodePayload(addNode(N_NUMBER, compiler->currentToken->offset))->value = compiler->currentToken->value;
+    constValue = makeIntConstant(compiler->currentToken->value);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
+    nodePayload(addNode(N_CONST_REF, compiler->currentToken->offset))->name = compiler->currentToken->atom;
 
-    obj = checkDeclaredConstant(currentToken->string);
+    obj = checkDeclaredConstant(compiler->currentToken->atom);
     constValue = duplicateConstantValue(obj->constAttrs->value);
 
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    addCharNode();
+    constValue = makeCharConstant(compiler->currentToken->string[0]);
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_CONSTANT, compiler->lookAhead->offset);
+    constValue = makeIntConstant(0);
     break;
   }
   return constValue;
@@ -227,19 +439,24 @@ ConstantValue* compileUnsignedConstant(void) {
 ConstantValue* compileConstant(void) {
   ConstantValue* constValue;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case SB_PLUS:
     eat(SB_PLUS);
+    nodePayload(beginNode(N_UNARY, compiler->currentToken->offset))->op = SB_PLUS;
     constValue = compileConstant2();
+    endNode();
     break;
   case SB_MINUS:
     eat(SB_MINUS);
+    nodePayload(beginNode(N_UNARY, compiler->currentToken->offset))->op = SB_MINUS;
     constValue = compileConstant2();
+    endNode();
     constValue->intValue = - constValue->intValue;
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    addCharNode();
+    constValue = makeCharConstant(compiler->currentToken->string[0]);
     break;
   default:
     constValue = compileConstant2();
@@ -252,21 +469,26 @@ ConstantValue* compileConstant2(void) {
   ConstantValue* constValue;
   Object* obj;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    constValue = makeIntConstant(currentToken->value);
+    nodePayload(addNode(N_NUMBER, compiler->currentToken->offset))->value = compiler->currentToken->value;
+    constValue = makeIntConstant(compiler->currentToken->value);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredConstant(currentToken->string);
+    nodePayload(addNode(N_CONST_REF, compiler->currentToken->offset))->name = compiler->currentToken->atom;
+    obj = checkDeclaredConstant(compiler->currentToken->atom);
     if (obj->constAttrs->value->type == TP_INT)
       constValue = duplicateConstantValue(obj->constAttrs->value);
-    else
-      error(ERR_UNDECLARED_INT_CONSTANT,currentToken->lineNo, currentToken->colNo);
+    else {
+      error(ERR_UNDECLARED_INT_CONSTANT,compiler->currentToken->offset);
+      constValue = makeIntConstant(0);
+    }
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_CONSTANT, compiler->lookAhead->offset);
+    constValue = makeIntConstant(0);
     break;
   }
   return constValue;
@@ -277,35 +499,43 @@ Type* compileType(void) {
   Type* elementType;
   int arraySize;
   Object* obj;
+  NodeId node;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case KW_INTEGER: 
     eat(KW_INTEGER);
+    addNode(N_INT_TYPE, compiler->currentToken->offset);
     type =  makeIntType();
     break;
   case KW_CHAR: 
     eat(KW_CHAR); 
+    addNode(N_CHAR_TYPE, compiler->currentToken->offset);
     type = makeCharType();
     break;
   case KW_ARRAY:
+    node = beginNode(N_ARRAY_TYPE, compiler->lookAhead->offset);
     eat(KW_ARRAY);
     eat(SB_LSEL);
     eat(TK_NUMBER);
 
-    arraySize = currentToken->value;
+    arraySize = compiler->currentToken->value;
+    nodePayload(node)->value = arraySize;
 
     eat(SB_RSEL);
     eat(KW_OF);
     elementType = compileType();
+    endNode();
     type = makeArrayType(arraySize, elementType);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredType(currentToken->string);
+    nodePayload(addNode(N_NAMED_TYPE, compiler->currentToken->offset))->name = compiler->currentToken->atom;
+    obj = checkDeclaredType(compiler->currentToken->atom);
     type = duplicateType(obj->typeAttrs->actualType);
     break;
   default:
-    error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_TYPE, compiler->lookAhead->offset);
+    type = NULL;
     break;
   }
   return type;
@@ -314,27 +544,30 @@ Type* compileType(void) {
 Type* compileBasicType(void) {
   Type* type;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case KW_INTEGER: 
     eat(KW_INTEGER); 
+    addNode(N_INT_TYPE, compiler->currentToken->offset);
     type = makeIntType();
     break;
   case KW_CHAR: 
     eat(KW_CHAR); 
+    addNode(N_CHAR_TYPE, compiler->currentToken->offset);
     type = makeCharType();
     break;
   default:
-    error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_BASICTYPE, compiler->lookAhead->offset);
+    type = NULL;
     break;
   }
   return type;
 }
 
 void compileParams(void) {
-  if (lookAhead->tokenType == SB_LPAR) {
+  if (compiler->lookAhead->tokenType == SB_LPAR) {
     eat(SB_LPAR);
     compileParam();
-    while (lookAhead->tokenType == SB_SEMICOLON) {
+    while (compiler->lookAhead->tokenType == SB_SEMICOLON) {
       eat(SB_SEMICOLON);
       compileParam();
     }
@@ -346,8 +579,9 @@ void compileParam(void) {
   Object* param;
   Type* type;
   enum ParamKind paramKind;
+  NodeId node;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case TK_IDENT:
     paramKind = PARAM_VALUE;
     break;
@@ -356,29 +590,34 @@ void compileParam(void) {
     paramKind = PARAM_REFERENCE;
     break;
   default:
-    error(ERR_INVALID_PARAMETER, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_PARAMETER, compiler->lookAhead->offset);
+    paramKind = PARAM_VALUE;
     break;
   }
 
   eat(TK_IDENT);
-  checkFreshIdent(currentToken->string);
-  param = createParameterObject(currentToken->string, paramKind, symtab->currentScope->owner);
+  checkFreshIdent(compiler->currentToken->atom);
+  param = createParameterObject(compiler->currentToken->atom, paramKind, compiler->symtab->currentScope->owner);
+  node = beginNode((paramKind == PARAM_VALUE) ? N_VALUE_PARAM : N_REF_PARAM, compiler->currentToken->offset);
+  nodePayload(node)->name = compiler->currentToken->atom;
   eat(SB_COLON);
   type = compileBasicType();
+  endNode();
   param->paramAttrs->type = type;
   declareObject(param);
 }
 
 void compileStatements(void) {
   compileStatement();
-  while (lookAhead->tokenType == SB_SEMICOLON) {
+  while (compiler->lookAhead->tokenType == SB_SEMICOLON) {
     eat(SB_SEMICOLON);
     compileStatement();
   }
 }
 
 void compileStatement(void) {
-  switch (lookAhead->tokenType) {
+ retry:
+  switch (compiler->lookAhead->tokenType) {
   case TK_IDENT:
     compileAssignSt();
     break;
@@ -397,14 +636,14 @@ void compileStatement(void) {
   case KW_FOR:
     compileForSt();
     break;
-    // EmptySt needs to check FOLLOW tokens
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-    break;
-    // Error occurs
   default:
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+    // EmptySt needs to check FOLLOW tokens
+    if (inTokenSet(FOLLOW_Statement, compiler->lookAhead->tokenType)) {
+      addNode(N_EMPTY, compiler->lookAhead->offset);
+      break;
+    }
+    syntaxError(ERR_INVALID_STATEMENT, compiler->lookAhead->offset);
+    if (skipToken()) goto retry;
     break;
   }
 }
@@ -415,14 +654,16 @@ Type* compileLValue(void) {
   Type* varType = NULL;
 
   eat(TK_IDENT);
+  nodePayload(beginNode(N_VARIABLE, compiler->currentToken->offset))->name = compiler->currentToken->atom;
   // check if the identifier is a function identifier, or a variable identifier, or a parameter  
-  var = checkDeclaredLValueIdent(currentToken->string);
+  var = checkDeclaredLValueIdent(compiler->currentToken->atom);
   if (var->kind == OBJ_VARIABLE)
     varType = compileIndexes(var->varAttrs->type);
   else if (var->kind == OBJ_FUNCTION)
     varType = var->funcAttrs->returnType;
   else if (var->kind == OBJ_PARAMETER)
     varType = var->paramAttrs->type;
+  endNode();
 
   return varType;
 }
@@ -432,36 +673,46 @@ void compileAssignSt(void) {
   Type* lvalueType = NULL;
   Type* expType = NULL;
 
+  beginNode(N_ASSIGN, compiler->lookAhead->offset);
   lvalueType = compileLValue();
   eat(SB_ASSIGN);
   expType = compileExpression();
+  endNode();
   checkTypeEquality(lvalueType, expType);
 }
 
 void compileCallSt(void) {
   Object* proc;
+  NodeId node;
 
+  node = beginNode(N_CALL, compiler->lookAhead->offset);
   eat(KW_CALL);
   eat(TK_IDENT);
 
-  proc = checkDeclaredProcedure(currentToken->string);
+  nodePayload(node)->name = compiler->currentToken->atom;
+  proc = checkDeclaredProcedure(compiler->currentToken->atom);
 
   compileArguments(proc->procAttrs->paramList);
+  endNode();
 }
 
 void compileGroupSt(void) {
+  beginNode(N_GROUP, compiler->lookAhead->offset);
   eat(KW_BEGIN);
   compileStatements();
   eat(KW_END);
+  endNode();
 }
 
 void compileIfSt(void) {
+  beginNode(N_IF, compiler->lookAhead->offset);
   eat(KW_IF);
   compileCondition();
   eat(KW_THEN);
   compileStatement();
-  if (lookAhead->tokenType == KW_ELSE) 
+  if (compiler->lookAhead->tokenType == KW_ELSE) 
     compileElseSt();
+  endNode();
 }
 
 void compileElseSt(void) {
@@ -470,22 +721,27 @@ void compileElseSt(void) {
 }
 
 void compileWhileSt(void) {
+  beginNode(N_WHILE, compiler->lookAhead->offset);
   eat(KW_WHILE);
   compileCondition();
   eat(KW_DO);
   compileStatement();
+  endNode();
 }
 
 void compileForSt(void) {
   // TODO: Check type consistency of FOR's variable
   Type* exp1Type = NULL;
   Type* exp2Type = NULL;
+  NodeId node;
 
+  node = beginNode(N_FOR, compiler->lookAhead->offset);
   eat(KW_FOR);
   eat(TK_IDENT);
+  nodePayload(node)->name = compiler->currentToken->atom;
 
   // check if the identifier is a variable
-  Object* var = checkDeclaredVariable(currentToken->string);
+  Object* var = checkDeclaredVariable(compiler->currentToken->atom);
 
   eat(SB_ASSIGN);
   exp1Type = compileExpression();
@@ -499,16 +755,22 @@ void compileForSt(void) {
 
   eat(KW_DO);
   compileStatement();
+  endNode();
 }
 
 void compileArgument(Object* param) {
   // TODO: parse an argument, and check type consistency
   //       If the corresponding parameter is a reference, the argument must be a lvalue
+  // param is NULL for the arguments of a stand-in for an undeclared callee
+  if (param == NULL) {
+    compileExpression();
+    return;
+  }
   if (param->paramAttrs->kind == PARAM_REFERENCE) {
-    if (lookAhead->tokenType == TK_IDENT) {
-      checkDeclaredLValueIdent(lookAhead->string);
+    if (compiler->lookAhead->tokenType == TK_IDENT) {
+      checkDeclaredLValueIdent(compiler->lookAhead->atom);
     } else {
-      error(ERR_TYPE_INCONSISTENCY, lookAhead->lineNo, lookAhead->colNo);
+      error(ERR_TYPE_INCONSISTENCY, compiler->lookAhead->offset);
     }
   }
   Type* argType = compileExpression();
@@ -517,45 +779,32 @@ void compileArgument(Object* param) {
 
 void compileArguments(ObjectNode* paramList) {
   //TODO: parse a list of arguments, check the consistency of the arguments and the given parameters
-  switch (lookAhead->tokenType) {
+ retry:
+  switch (compiler->lookAhead->tokenType) {
   case SB_LPAR:
     eat(SB_LPAR);
-    compileArgument(paramList->object);
+    if (paramList == NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, compiler->currentToken->offset);
+    compileArgument((paramList != NULL) ? paramList->object : NULL);
 
-    while (lookAhead->tokenType == SB_COMMA) {
+    while (compiler->lookAhead->tokenType == SB_COMMA) {
       eat(SB_COMMA);
-      paramList = paramList->next;
-      if (paramList != NULL)
-        compileArgument(paramList->object);
-      else
-        error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+      if (paramList != NULL) {
+        paramList = paramList->next;
+        if (paramList == NULL)
+          error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, compiler->currentToken->offset);
+      }
+      compileArgument((paramList != NULL) ? paramList->object : NULL);
     }
     
     eat(SB_RPAR);
     break;
-    // Check FOLLOW set 
-  case SB_TIMES:
-  case SB_SLASH:
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    break;
   default:
-    error(ERR_INVALID_ARGUMENTS, lookAhead->lineNo, lookAhead->colNo);
+    // Check FOLLOW set
+    if (inTokenSet(FOLLOW_Arguments, compiler->lookAhead->tokenType))
+      break;
+    syntaxError(ERR_INVALID_ARGUMENTS, compiler->lookAhead->offset);
+    if (skipToken()) goto retry;
   }
 }
 
@@ -565,7 +814,7 @@ void compileCondition(void) {
   Type* rhs = NULL;
   lhs = compileExpression();
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case SB_EQ:
     eat(SB_EQ);
     break;
@@ -585,128 +834,99 @@ void compileCondition(void) {
     eat(SB_GT);
     break;
   default:
-    error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_COMPARATOR, compiler->lookAhead->offset);
   }
 
+  nodePayload(wrapNode(N_BINARY, compiler->currentToken->offset))->op = compiler->currentToken->tokenType;
   rhs = compileExpression();
+  endNode();
   checkTypeEquality(rhs, lhs);
 }
 
-Type* compileExpression(void) {
-  Type* type;
-  
-  switch (lookAhead->tokenType) {
+/*
+ * Expressions are compiled by precedence climbing in a loop rather than by
+ * one call per operator. An operator waits, with its node left open, until
+ * its right operand is complete: until an operator that binds no tighter
+ * comes, or the expression ends. Operators are left associative, so at
+ * most one of each level waits at a time. A sign waits as a + would, and
+ * applies to the first term only.
+ */
+#define TERM_LEVEL 2
+#define OPERATOR_LEVELS 2
+
+typedef struct {
+  int level;
+  Type* operand;          // the first factor of the right operand; NULL for a sign
+} OpenOperator;
+
+int operatorLevel(TokenType tokenType) {
+  switch (tokenType) {
   case SB_PLUS:
-    eat(SB_PLUS);
-    type = compileExpression2();
-    checkIntType(type);
-    break;
   case SB_MINUS:
-    eat(SB_MINUS);
-    type = compileExpression2();
-    checkIntType(type);
-    break;
+    return 1;
+  case SB_TIMES:
+  case SB_SLASH:
+    return TERM_LEVEL;
   default:
-    type = compileExpression2();
+    return 0;
   }
-  return type;
 }
 
-Type* compileExpression2(void) {
-  Type* type;
-
-  type = compileTerm();
-  compileExpression3();
-
-  return type;
+// Closes the waiting operators of at least the given level
+void closeOperators(OpenOperator* open, int* count, int level) {
+  while ((*count > 0) && (open[*count - 1].level >= level)) {
+    (*count) --;
+    endNode();
+    if (open[*count].operand != NULL)
+      checkIntType(open[*count].operand);
+  }
 }
 
-
-void compileExpression3(void) {
+Type* compileExpression(void) {
+  OpenOperator open[OPERATOR_LEVELS];
+  int count = 0;
+  int level, sign = 0;
   Type* type;
+  TokenType op;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case SB_PLUS:
-    eat(SB_PLUS);
-    type = compileTerm();
-    checkIntType(type);
-    compileExpression3();
-    break;
   case SB_MINUS:
-    eat(SB_MINUS);
-    type = compileTerm();
-    checkIntType(type);
-    compileExpression3();
-    break;
-    // check the FOLLOW set
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
+    eat(compiler->lookAhead->tokenType);
+    nodePayload(beginNode(N_UNARY, compiler->currentToken->offset))->op = compiler->currentToken->tokenType;
+    open[count].level = 1;
+    open[count++].operand = NULL;
+    sign = 1;
     break;
   default:
-    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    break;
   }
-}
-
-Type* compileTerm(void) {
-  Type* type;
-
   type = compileFactor();
-  compileTerm2();
 
-  return type;
-}
+  while (1) {
+    op = compiler->lookAhead->tokenType;
+    level = operatorLevel(op);
+    if (level == 0) {
+      // The term is complete even if the token is wrong
+      closeOperators(open, &count, TERM_LEVEL);
+      if (inTokenSet(FOLLOW_Term2, op))
+        break;
+      syntaxError(ERR_INVALID_TERM, compiler->lookAhead->offset);
+      if (skipToken()) continue;
+      break;
+    }
 
-void compileTerm2(void) {
-  Type* type;
+    closeOperators(open, &count, level);
+    eat(op);
+    nodePayload(wrapNode(N_BINARY, compiler->currentToken->offset))->op = op;
+    open[count].level = level;
+    open[count++].operand = compileFactor();
+  }
 
-  switch (lookAhead->tokenType) {
-  case SB_TIMES:
-    eat(SB_TIMES);
-    type = compileFactor();
+  closeOperators(open, &count, 1);
+  if (sign)
     checkIntType(type);
-    compileTerm2();
-    break;
-  case SB_SLASH:
-    eat(SB_SLASH);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
-    // check the FOLLOW set
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    break;
-  default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
-  }
+  return type;
 }
 
 Type* compileFactor(void) {
@@ -715,46 +935,53 @@ Type* compileFactor(void) {
   Object* obj;
   Type* type;
 
-  switch (lookAhead->tokenType) {
+  switch (compiler->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
+    nodePayload(addNode(N_NUMBER, compiler->currentToken->offset))->value = compiler->currentToken->value;
     type = makeIntType();
     break;
   case TK_CHAR:
     eat(TK_CHAR);
+    addCharNode();
     type = makeCharType();
     break;
   case TK_IDENT:
     eat(TK_IDENT);
     // check if the identifier is declared
-    obj = checkDeclaredIdent(currentToken->string);
+    obj = checkDeclaredIdent(compiler->currentToken->atom);
 
     switch (obj->kind) {
     case OBJ_CONSTANT:
+      nodePayload(addNode(N_CONST_REF, compiler->currentToken->offset))->name = obj->name;
       // use as an empty type
       type = makeIntType();
       type->typeClass = obj->constAttrs->value->type;
       break;
     case OBJ_VARIABLE:
-      if (type->typeClass != TP_ARRAY)
-        type = obj->varAttrs->type;
-      else
-        type = compileIndexes(obj->varAttrs->type);
+      nodePayload(beginNode(N_VARIABLE, compiler->currentToken->offset))->name = obj->name;
+      type = compileIndexes(obj->varAttrs->type);
+      endNode();
       break;
     case OBJ_PARAMETER:
+      nodePayload(addNode(N_VARIABLE, compiler->currentToken->offset))->name = obj->name;
       type = obj->paramAttrs->type;
       break;
     case OBJ_FUNCTION:
+      nodePayload(beginNode(N_FUNC_CALL, compiler->currentToken->offset))->name = obj->name;
       type = obj->funcAttrs->returnType;
       compileArguments(obj->funcAttrs->paramList);
+      endNode();
       break;
     default: 
-      error(ERR_INVALID_FACTOR,currentToken->lineNo, currentToken->colNo);
+      error(ERR_INVALID_FACTOR,compiler->currentToken->offset);
+      type = NULL;
       break;
     }
     break;
   default:
-    error(ERR_INVALID_FACTOR, lookAhead->lineNo, lookAhead->colNo);
+    syntaxError(ERR_INVALID_FACTOR, compiler->lookAhead->offset);
+    type = NULL;
   }
   
   return type;
@@ -764,7 +991,7 @@ Type* compileIndexes(Type* arrayType) {
   // TODO: parse a sequence of indexes, check the consistency to the arrayType, and return the element type
   Type* indxType = NULL;
   Type* elmType = NULL;
-  while (lookAhead->tokenType == SB_LSEL) {
+  while (compiler->lookAhead->tokenType == SB_LSEL) {
     eat(SB_LSEL);
 
     // if current element is not of array type,
@@ -776,7 +1003,10 @@ Type* compileIndexes(Type* arrayType) {
 
     eat(SB_RSEL);
 
-    arrayType = arrayType->elementType;
+    // past an error the element type is unknown
+    if ((arrayType != NULL) && (arrayType->typeClass == TP_ARRAY))
+      arrayType = arrayType->elementType;
+    else arrayType = NULL;
   }
 
   // finally an array becomes an element type
@@ -785,24 +1015,95 @@ Type* compileIndexes(Type* arrayType) {
   return elmType;
 }
 
-int compile(char *fileName) {
-  if (openInputStream(fileName) == IO_ERROR)
-    return IO_ERROR;
+// Fills tokens from the cache when there is a valid cache file, otherwise
+// by scanning; a cache file that is missing or does not match is written
+// again
+void tokenizeUnit(void) {
+  TokenBuffer cached;
+  long diff;
+
+  initTokenBuffer(&compiler->unitTokens);
+  if ((compiler->tokenCacheDir != NULL) && !compiler->validateCache && loadTokenCache(&compiler->unitTokens, compiler->tokenCacheDir))
+    return;
+
+  if (compiler->lexThreads > 1)
+    tokenizeParallel(&compiler->unitTokens, compiler->lexThreads);
+  else tokenizeInput(&compiler->unitTokens);
+  if (compiler->tokenCacheDir == NULL)
+    return;
+
+  if (compiler->validateCache) {
+    initTokenBuffer(&cached);
+    if (loadTokenCache(&cached, compiler->tokenCacheDir)) {
+      diff = compareTokens(&compiler->unitTokens, &cached);
+      freeTokenBuffer(&cached);
+      if (diff < 0)
+	return;
+      printf("Token cache differs from the source at token %ld.\n", diff);
+    }
+  }
+  saveTokenCache(&compiler->unitTokens, compiler->tokenCacheDir);
+}
 
-  currentToken = NULL;
-  lookAhead = getValidToken();
+int compileInput(void) {
+  compiler->currentToken = NULL;
+  compiler->lookAhead = NULL;
+  compiler->symtab = NULL;
+  compiler->panicking = 0;
+  compiler->errorCount = 0;
+  compiler->ringFirst = compiler->ringCount = 0;
+  compiler->bodyCount = 0;
+
+  // The maxErrors-th error comes back here
+  if (setjmp(compiler->errorExit) == 0) {
+    if (compiler->preTokenize) {
+      tokenizeUnit();
+      compiler->tokenIndex = 0;
+    }
+    compiler->lookAhead = readToken();
 
-  initSymTab();
+    initSymTab();
 
-  compileProgram();
+    if (compiler->checkSyntaxOnly)
+      checkSyntax();
+    else compileProgram();
+    if (compiler->outline && (compiler->outlineBody != NULL) && !compiler->checkSyntaxOnly)
+      compileOutlineBodies();
 
-  printObject(symtab->program,0);
+    // Past an error the tables are incomplete and are not shown
+    if ((compiler->errorCount == 0) && !compiler->checkSyntaxOnly) {
+      printObject(compiler->symtab->program,0);
+      if (compiler->printTree)
+	printNode(compiler->astRoot, 0);
+    }
+
+    if (compiler->currentToken != NULL) freeToken(compiler->currentToken);
+    freeToken(compiler->lookAhead);
+    while (compiler->ringCount > 0)
+      freeToken(nextToken());
+  } else freeTokenPool();
 
+  freeErrorObjects();
   cleanSymTab();
+  freeAst();
+  freeAtoms();
 
-  free(currentToken);
-  free(lookAhead);
+  if (compiler->preTokenize)
+    freeTokenBuffer(&compiler->unitTokens);
   closeInputStream();
   return IO_SUCCESS;
+}
+
+int compile(CompilerContext *context, char *fileName) {
+  useCompiler(context);
+  if (openInputStream(fileName) == IO_ERROR)
+    return IO_ERROR;
+  return compileInput();
+}
 
+int compileBuffer(CompilerContext *context, const char *buffer, size_t length, const char *name) {
+  useCompiler(context);
+  if (openInputBuffer(buffer, length, name) == IO_ERROR)
+    return IO_ERROR;
+  return compileInput();
 }
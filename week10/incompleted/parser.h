@@ -5,11 +5,40 @@
  */
 #ifndef __PARSER_H__
 #define __PARSER_H__
+#include <stddef.h>
 #include "token.h"
 #include "symtab.h"
+#include "ast.h"
+#include "error.h"
 
+// Tokens that can be inspected past lookAhead: peekToken(1) is lookAhead,
+// peekToken(k) the token k - 1 places after it, for k up to
+// MAX_LOOKAHEAD + 1
+#define MAX_LOOKAHEAD 4
+
+Token* peekToken(int k);
 void scan(void);
 void eat(TokenType tokenType);
+// Reports a syntax error unless one is being recovered from
+void syntaxError(ErrorCode err, SourcePos pos);
+// Skips lookAhead; fails at the end of the input
+int skipToken(void);
+
+// A BEGIN ... END body that outline mode skipped: the declarations of its
+// scope are complete, and its statements can be compiled later
+typedef struct {
+  Scope* scope;                 // of the program, function or procedure
+  SourcePos from;               // BEGIN
+  SourcePos to;                 // past END
+  long tokenIndex;              // of BEGIN, with preTokenize
+  NodeId node;                  // N_BODY, the N_GROUP once compiled
+  int compiled;
+} SkippedBody;
+
+// Compiles a skipped body in its scope, where everything declared in the
+// unit is visible; fails on streamed input without preTokenize, which
+// cannot go back
+int compileBody(SkippedBody *body);
 
 void compileProgram(void);
 void compileBlock(void);
@@ -47,13 +76,13 @@ void compileArgument(Object* param);
 void compileArguments(ObjectNode* paramList);
 void compileCondition(void);
 Type* compileExpression(void);
-Type* compileExpression2(void);
-void compileExpression3(void);
-Type* compileTerm(void);
-void compileTerm2(void);
 Type* compileFactor(void);
 Type* compileIndexes(Type* arrayType);
 
-int compile(char *fileName);
+// Compile a unit in context, which must not be in use by another thread
+// meanwhile
+struct CompilerContext;
+int compile(struct CompilerContext *context, char *fileName);
+int compileBuffer(struct CompilerContext *context, const char *buffer, size_t length, const char *name);
 
 #endif
@@ -0,0 +1,329 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "reader.h"
+#include "utf8.h"
+#include "vscan.h"
+#include "error.h"
+#include "dfa.h"
+#include "plex.h"
+#include "context.h"
+
+// Inputs are only split into chunks of at least this many bytes
+#ifndef PARALLEL_MIN_CHUNK
+#define PARALLEL_MIN_CHUNK (1 << 18)
+#endif
+
+/*
+ * Chunks start just after a newline. Whatever came before, the DFA state
+ * after a blank is one of three: between tokens (S_START), inside a
+ * comment (S_COMMENT), or after the character of a char constant whose
+ * character was that blank (S_CHAR_END). Each chunk is lexed at the same
+ * time from the first two; the joining pass follows the actual state from
+ * chunk to chunk, and lexes a chunk again in the rare case it starts after
+ * the character of a char constant.
+ */
+enum Speculation {
+  SPEC_START,
+  SPEC_COMMENT,
+  SPEC_CHAR_END,
+  SPECULATIONS
+};
+
+int specStates[SPECULATIONS] = {S_START, S_COMMENT, S_CHAR_END};
+
+void pushToken(ChunkLex *chunk, TokenType tokenType, const unsigned char *p, int value) {
+  TokenBuffer *tokens = &chunk->tokens;
+  long i = tokens->count;
+
+  if (i == tokens->capacity)
+    reserveTokens(tokens, (i == 0) ? 1024 : i * 2);
+  tokens->types[i] = tokenType;
+  tokens->offsets[i] = p - chunk->text;
+  tokens->payloads[i].value = value;
+  tokens->count ++;
+}
+
+// Records an error; returns whether lexing goes on after it
+int pushError(ChunkLex *chunk, ErrorCode err, const unsigned char *p) {
+  pushToken(chunk, TK_NONE, p, err);
+  if (chunk->recover) return 1;
+  chunk->exitState = -1;
+  return 0;
+}
+
+// Length of the valid UTF-8 sequence at p, or 0
+int utf8Length(const unsigned char *p, const unsigned char *end) {
+  int len = utf8SequenceLength(*p);
+  int i;
+
+  if (end - p < len) return 0;
+  for (i = 1; i < len; i ++)
+    if (!utf8ValidContinuation(*p, i, p[i])) return 0;
+  return len;
+}
+
+// Bytes of the malformed sequence at p that readUtf8Char reads: the lead
+// byte, unless it cannot start a sequence, and the valid continuation
+// bytes after it
+int utf8BadLength(const unsigned char *p, const unsigned char *end) {
+  int len = utf8SequenceLength(*p);
+  int i;
+
+  if (len == 0) return 0;
+  for (i = 1; (i < len) && (p + i < end) && utf8ValidContinuation(*p, i, p[i]); i ++) ;
+  return i;
+}
+
+void lexChunk(ChunkLex *chunk) {
+  const unsigned char *text = chunk->text;
+  const unsigned char *p = text + chunk->from;
+  const unsigned char *limit = text + chunk->to;
+  const unsigned char *end = text + chunk->size;
+  const unsigned char *start = NULL;
+  const unsigned char *q;
+  int state = chunk->startState;
+  char charText[8];
+  DfaEntry *entry;
+  TokenType tokenType;
+  long long value;
+  int count, len;
+
+  initTokenBuffer(&chunk->tokens);
+  if (state == S_CHAR_END) {
+    start = p - 2;
+    charText[0] = p[-1];
+    charText[1] = '\0';
+  }
+
+  while (1) {
+    if ((p == limit) && (limit < end)) {
+      chunk->exitState = state;
+      return;
+    }
+    entry = &dfaTable[state][(p < end) ? dfaClasses[*p + 1] : CLASS_EOF];
+
+    switch (entry->action) {
+    case A_SKIP:
+      p ++;
+      // Runs of blanks and of plain comment text go in bulk
+      if ((entry->next == S_START) && (state == S_START))
+	p = vscanBlanks(p, limit);
+      else if (entry->next == S_COMMENT)
+	p = vscanCommentText(p, limit);
+      break;
+    case A_MARK:
+      start = p++;
+      break;
+
+    case A_MARK_LETTER:
+      q = vscanAlnum(p + 1, limit);
+      count = q - p;
+      if (count > MAX_IDENT_LEN) {
+	if (!pushError(chunk, ERR_IDENT_TOO_LONG, p)) return;
+      } else {
+	tokenType = checkKeywordSpan(p, count);
+	if (tokenType == TK_NONE)
+	  pushToken(chunk, TK_IDENT, p, count);
+	else pushToken(chunk, tokenType, p, 0);
+      }
+      p = q;
+      break;
+    case A_MARK_DIGIT:
+      q = vscanDigits(p + 1, limit);
+      value = decimalValue(p, q - p);
+      if (value > INT_MAX) {
+	if (!pushError(chunk, ERR_NUMBER_TOO_LARGE, p)) return;
+      } else pushToken(chunk, TK_NUMBER, p, (int) value);
+      p = q;
+      break;
+
+    case A_STORE_CHAR:
+      charText[0] = *p++;
+      charText[1] = '\0';
+      break;
+    case A_UTF8_CHAR:
+      len = utf8Length(p, end);
+      if (len == 0) {
+	if (!pushError(chunk, ERR_INVALID_CONSTANT_CHAR, start)) return;
+	// Going on where the scanner does
+	p += utf8BadLength(p, end);
+	state = S_START;
+	continue;
+      }
+      memcpy(charText, p, len);
+      charText[len] = '\0';
+      p += len;
+      break;
+    case A_UTF8_COMMENT:
+      p = utf8SkipText(p, limit);
+      if ((p < limit) && isUtf8Byte(*p)) {
+	len = utf8Length(p, end);
+	if (len == 0) {
+	  if (!pushError(chunk, ERR_INVALID_UTF8, p)) return;
+	  len = utf8BadLength(p, end);
+	  if (len == 0) len = 1;
+	}
+	p += len;
+      }
+      break;
+
+    case A_SINGLE:
+      pushToken(chunk, entry->tokenType, p, 0);
+      p ++;
+      break;
+    case A_COMPLETE:
+      p ++;
+      if ((entry->tokenType == TK_CHAR) && isUtf8Byte((unsigned char) charText[0])) {
+	if (!pushError(chunk, ERR_WIDE_CONSTANT_CHAR, start)) return;
+	break;
+      }
+      pushToken(chunk, entry->tokenType, start, 0);
+      // pushToken zeroed the payload; the bytes past the character stay
+      // zero, as the payload goes as it is into cache files
+      if (entry->tokenType == TK_CHAR)
+	memcpy(chunk->tokens.payloads[chunk->tokens.count - 1].text, charText, strlen(charText) + 1);
+      break;
+    case A_EMIT:
+      pushToken(chunk, entry->tokenType, start, 0);
+      break;
+    case A_EOF:
+      pushToken(chunk, TK_EOF, p, 0);
+      chunk->exitState = -1;
+      return;
+
+    case A_INVALID:
+      if (!pushError(chunk, ERR_INVALID_SYMBOL, p)) return;
+      p ++;
+      break;
+    case A_INVALID_MARK:
+      if (!pushError(chunk, ERR_INVALID_SYMBOL, start)) return;
+      break;
+    case A_BAD_CHAR:
+      if (!pushError(chunk, ERR_INVALID_CONSTANT_CHAR, start)) return;
+      break;
+    case A_BAD_COMMENT:
+      if (pushError(chunk, ERR_END_OF_COMMENT, p))
+	pushToken(chunk, TK_EOF, p, 0);
+      chunk->exitState = -1;
+      return;
+    }
+
+    state = entry->next;
+  }
+}
+
+void *lexChunks(void *arg) {
+  ChunkLex *chunk = (ChunkLex*) arg;
+
+  lexChunk(&chunk[SPEC_START]);
+  chunk[SPEC_START].done = 1;
+  if (chunk[SPEC_COMMENT].from > 0) {
+    lexChunk(&chunk[SPEC_COMMENT]);
+    chunk[SPEC_COMMENT].done = 1;
+  }
+  return NULL;
+}
+
+// Chunk boundaries, each just after a newline; returns the number of chunks
+int splitInput(const unsigned char *text, long size, int chunks, long *bounds) {
+  const unsigned char *nl;
+  long nominal;
+  int n = 0, i;
+
+  bounds[n++] = 0;
+  for (i = 1; i < chunks; i ++) {
+    nominal = size / chunks * i;
+    if (nominal <= bounds[n - 1]) continue;
+    nl = memchr(text + nominal, '\n', size - nominal);
+    if ((nl == NULL) || (nl + 1 - text >= size)) break;
+    bounds[n++] = nl + 1 - text;
+  }
+  bounds[n] = size;
+  return n;
+}
+
+// Appends a chunk to the result, interning identifiers. Errors stay in
+// as TK_NONE entries, as tokenizeInput stores them.
+void joinChunk(TokenBuffer *buffer, ChunkLex *chunk) {
+  TokenBuffer *tokens = &chunk->tokens;
+  long i, j;
+
+  if (buffer->count + tokens->count > buffer->capacity)
+    reserveTokens(buffer, (buffer->capacity * 2 > buffer->count + tokens->count) ?
+		  buffer->capacity * 2 : buffer->count + tokens->count);
+
+  for (i = 0; i < tokens->count; i ++) {
+    j = buffer->count ++;
+    buffer->types[j] = tokens->types[i];
+    buffer->offsets[j] = tokens->offsets[i];
+    buffer->payloads[j] = tokens->payloads[i];
+    if (tokens->types[i] == TK_IDENT)
+      buffer->payloads[j].atom = internSpan(chunk->text + tokens->offsets[i],
+					    tokens->payloads[i].value);
+  }
+}
+
+long tokenizeParallel(TokenBuffer *buffer, int threads) {
+  const unsigned char *text = compiler->inputStart;
+  long size = compiler->inputEnd - compiler->inputStart;
+  long *bounds;
+  ChunkLex *chunks;
+  pthread_t *workers;
+  int count, i, s, state;
+
+  if (!sourceResident() || (threads < 2) || (size < 2 * PARALLEL_MIN_CHUNK))
+    return tokenizeInput(buffer);
+  if (threads > size / PARALLEL_MIN_CHUNK)
+    threads = size / PARALLEL_MIN_CHUNK;
+
+  bounds = (long*) malloc((threads + 1) * sizeof(long));
+  count = splitInput(text, size, threads, bounds);
+
+  chunks = (ChunkLex*) calloc(count * SPECULATIONS, sizeof(ChunkLex));
+  for (i = 0; i < count; i ++)
+    for (s = 0; s < SPECULATIONS; s ++) {
+      chunks[i * SPECULATIONS + s].text = text;
+      chunks[i * SPECULATIONS + s].from = bounds[i];
+      chunks[i * SPECULATIONS + s].to = bounds[i + 1];
+      chunks[i * SPECULATIONS + s].size = size;
+      chunks[i * SPECULATIONS + s].startState = specStates[s];
+      // Errors are kept and lexing goes on, as in tokenizeInput
+      chunks[i * SPECULATIONS + s].recover = 1;
+    }
+
+  workers = (pthread_t*) malloc(count * sizeof(pthread_t));
+  for (i = 1; i < count; i ++)
+    pthread_create(&workers[i], NULL, lexChunks, &chunks[i * SPECULATIONS]);
+  lexChunks(&chunks[0]);
+  for (i = 1; i < count; i ++)
+    pthread_join(workers[i], NULL);
+
+  // Chunks are joined up to the one holding TK_EOF
+  state = S_START;
+  for (i = 0; (i < count) && (state >= 0); i ++) {
+    for (s = 0; specStates[s] != state; s ++) ;
+    if (!chunks[i * SPECULATIONS + s].done)
+      lexChunk(&chunks[i * SPECULATIONS + s]);
+    joinChunk(buffer, &chunks[i * SPECULATIONS + s]);
+    state = chunks[i * SPECULATIONS + s].exitState;
+  }
+
+  for (i = 0; i < count * SPECULATIONS; i ++)
+    freeTokenBuffer(&chunks[i].tokens);
+  free(chunks);
+  free(workers);
+  free(bounds);
+
+  // The reader is left at the end of the input
+  advanceTo(compiler->inputEnd);
+  return buffer->count;
+}
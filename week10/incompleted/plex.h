@@ -0,0 +1,38 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PLEX_H__
+#define __PLEX_H__
+
+#include "tokbuf.h"
+
+// The bytes [from, to) of text, lexed from startState. While a chunk is
+// lexed, identifiers carry their length, which the caller turns into an
+// atom, and errors are stored as TK_NONE with the error code. An error ends the
+// chunk unless 'recover' is set, in which case lexing goes on after the
+// offending bytes.
+typedef struct {
+  const unsigned char *text;
+  long from, to, size;
+  int startState;
+  int recover;
+  int done;
+  int exitState;                // state at 'to', or -1 at EOF or an error
+  TokenBuffer tokens;
+} ChunkLex;
+
+// 'to' must be the end of the text or lie just after a newline, and
+// startState one of S_START, S_COMMENT and S_CHAR_END
+void lexChunk(ChunkLex *chunk);
+
+// Does the work of tokenizeInput on up to 'threads' threads: the input,
+// opened and not yet read from, is cut into chunks that are lexed at the
+// same time and joined in order. The result, including the lexical errors
+// stored, is the same as that of tokenizeInput. Streamed input and inputs
+// too small to split are tokenized sequentially.
+long tokenizeParallel(TokenBuffer *buffer, int threads);
+
+#endif
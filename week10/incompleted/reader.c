@@ -5,33 +5,311 @@
  */
 
 #include <stdio.h>
-#include "reader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "context.h"
 
-FILE *inputStream;
-int lineNo, colNo;
-int currentChar;
+#define READ_CHUNK_SIZE 65536
 
-int readChar(void) {
-  currentChar = getc(inputStream);
-  colNo ++;
-  if (currentChar == '\n') {
-    lineNo ++;
-    colNo = 0;
+// Regular files larger than this are streamed through a window of
+// INPUT_WINDOW_SIZE bytes instead of being mapped
+#ifndef MAX_MAPPED_INPUT
+#define MAX_MAPPED_INPUT (1LL << 30)
+#endif
+
+#ifndef INPUT_WINDOW_SIZE
+#define INPUT_WINDOW_SIZE (1 << 20)
+#endif
+
+int mapInputFile(int fd, struct stat *st) {
+  void *p;
+
+  p = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED)
+    return IO_ERROR;
+  madvise(p, st->st_size, MADV_SEQUENTIAL);
+
+  compiler->inputBuffer = (unsigned char*) p;
+  compiler->inputSize = st->st_size;
+  compiler->inputKind = INPUT_MAPPED;
+  return IO_SUCCESS;
+}
+
+int readInputFile(int fd) {
+  size_t capacity = READ_CHUNK_SIZE;
+  unsigned char *buffer = (unsigned char*) malloc(capacity);
+  size_t size = 0;
+  ssize_t n;
+
+  if (buffer == NULL)
+    return IO_ERROR;
+
+  while (1) {
+    if (size == capacity) {
+      unsigned char *grown = (unsigned char*) realloc(buffer, capacity * 2);
+      if (grown == NULL) {
+	free(buffer);
+	return IO_ERROR;
+      }
+      buffer = grown;
+      capacity *= 2;
+    }
+    n = read(fd, buffer + size, capacity - size);
+    if (n == 0) break;
+    if (n < 0) {
+      free(buffer);
+      return IO_ERROR;
+    }
+    size += n;
   }
-  return currentChar;
+
+  compiler->inputBuffer = buffer;
+  compiler->inputSize = size;
+  compiler->inputKind = INPUT_BUFFERED;
+  return IO_SUCCESS;
 }
 
-int openInputStream(char *fileName) {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
+int streamInputFile(int fd) {
+  compiler->inputBuffer = (unsigned char*) malloc(INPUT_WINDOW_SIZE);
+  if (compiler->inputBuffer == NULL)
     return IO_ERROR;
-  lineNo = 1;
-  colNo = 0;
+
+  compiler->inputSize = 0;
+  compiler->inputKind = INPUT_STREAMED;
+  compiler->inputFd = fd;
+  compiler->anchorLineNo = 1;
+  compiler->anchorLineStart = 0;
+  return IO_SUCCESS;
+}
+
+void startInput(void) {
+  compiler->inputStart = compiler->inputPtr = compiler->inputBuffer;
+  compiler->inputEnd = compiler->inputBuffer + compiler->inputSize;
+  compiler->inputBase = 0;
+  compiler->lineStarts = NULL;
+  compiler->lineCount = 0;
   readChar();
+}
+
+int openInputStream(char *fileName) {
+  struct stat st;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return IO_ERROR;
+
+  compiler->inputName = NULL;
+  if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+    if (st.st_size > MAX_MAPPED_INPUT) {
+      if (streamInputFile(fd) == IO_SUCCESS) {
+	startInput();
+	return IO_SUCCESS;
+      }
+    } else if (mapInputFile(fd, &st) == IO_SUCCESS) {
+      close(fd);
+      startInput();
+      return IO_SUCCESS;
+    }
+  }
+
+  if (readInputFile(fd) == IO_ERROR) {
+    close(fd);
+    return IO_ERROR;
+  }
+  close(fd);
+  startInput();
+  return IO_SUCCESS;
+}
+
+int openInputBuffer(const char *buffer, size_t length, const char *name) {
+  if ((buffer == NULL) && (length > 0))
+    return IO_ERROR;
+
+  compiler->inputBuffer = (unsigned char*) buffer;
+  compiler->inputSize = length;
+  compiler->inputKind = INPUT_EXTERNAL;
+  compiler->inputName = name;
+  startInput();
   return IO_SUCCESS;
 }
 
 void closeInputStream() {
-  fclose(inputStream);
+  switch (compiler->inputKind) {
+  case INPUT_MAPPED:
+    munmap(compiler->inputBuffer, compiler->inputSize);
+    break;
+  case INPUT_BUFFERED:
+    free(compiler->inputBuffer);
+    break;
+  case INPUT_EXTERNAL:
+    break;
+  case INPUT_STREAMED:
+    free(compiler->inputBuffer);
+    close(compiler->inputFd);
+    break;
+  }
+  free(compiler->lineStarts);
+  compiler->lineStarts = NULL;
+  compiler->lineCount = 0;
+  compiler->inputBuffer = NULL;
+  compiler->inputName = NULL;
+  compiler->inputStart = compiler->inputPtr = compiler->inputEnd = NULL;
+}
+
+int sourceResident(void) {
+  return compiler->inputKind != INPUT_STREAMED;
+}
+
+ssize_t readFully(int fd, unsigned char *buffer, size_t size) {
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < size) {
+    n = read(fd, buffer + done, size - done);
+    if (n == 0) break;
+    if (n < 0) return -1;
+    done += n;
+  }
+  return done;
+}
+
+// Moves the line anchor over the whole window before it is replaced
+void advanceAnchor(void) {
+  const unsigned char *p = compiler->inputStart;
+  const unsigned char *nl;
+
+  while ((nl = memchr(p, '\n', compiler->inputEnd - p)) != NULL) {
+    compiler->anchorLineNo ++;
+    p = nl + 1;
+    compiler->anchorLineStart = compiler->inputBase + (p - compiler->inputStart);
+  }
+}
+
+int refillInput(void) {
+  ssize_t n;
+
+  if (compiler->inputKind != INPUT_STREAMED)
+    return EOF;
+
+  advanceAnchor();
+  compiler->inputBase += compiler->inputEnd - compiler->inputStart;
+
+  n = readFully(compiler->inputFd, compiler->inputBuffer, INPUT_WINDOW_SIZE);
+  if (n < 0) n = 0;
+  compiler->inputPtr = compiler->inputBuffer;
+  compiler->inputEnd = compiler->inputBuffer + n;
+  if (n == 0)
+    return EOF;
+  return *compiler->inputPtr++;
+}
+
+/******************* Position resolution ******************************/
+
+void buildLineIndex(void) {
+  const unsigned char *p = compiler->inputStart;
+  const unsigned char *nl;
+  SourcePos capacity = 1024;
+
+  compiler->lineStarts = (SourcePos*) malloc(capacity * sizeof(SourcePos));
+  compiler->lineStarts[0] = 0;
+  compiler->lineCount = 1;
+
+  while ((nl = memchr(p, '\n', compiler->inputEnd - p)) != NULL) {
+    if (compiler->lineCount == capacity) {
+      capacity *= 2;
+      compiler->lineStarts = (SourcePos*) realloc(compiler->lineStarts, capacity * sizeof(SourcePos));
+    }
+    p = nl + 1;
+    compiler->lineStarts[compiler->lineCount++] = p - compiler->inputStart;
+  }
+}
+
+void resolveIndexed(SourcePos pos, SourcePos *lineNo, SourcePos *colNo) {
+  SourcePos lo = 0, hi;
+
+  if (compiler->lineStarts == NULL)
+    buildLineIndex();
+
+  // the last line starting at or before pos
+  hi = compiler->lineCount - 1;
+  while (lo < hi) {
+    SourcePos mid = (lo + hi + 1) / 2;
+    if (compiler->lineStarts[mid] <= pos) lo = mid;
+    else hi = mid - 1;
+  }
+
+  *lineNo = lo + 1;
+  *colNo = pos - compiler->lineStarts[lo] + 1;
+}
+
+// Number of newlines in the bytes [from, to) of the streamed file
+SourcePos countFileLines(SourcePos from, SourcePos to) {
+  unsigned char buffer[READ_CHUNK_SIZE];
+  SourcePos count = 0;
+  ssize_t n, i;
+
+  while (from < to) {
+    n = (to - from < READ_CHUNK_SIZE) ? (to - from) : READ_CHUNK_SIZE;
+    n = pread(compiler->inputFd, buffer, n, from);
+    if (n <= 0) break;
+    for (i = 0; i < n; i ++)
+      if (buffer[i] == '\n') count ++;
+    from += n;
+  }
+  return count;
+}
+
+// Start of the line containing pos in the streamed file, read backwards
+SourcePos findFileLineStart(SourcePos pos) {
+  unsigned char buffer[READ_CHUNK_SIZE];
+  SourcePos from;
+  ssize_t n;
+
+  while (pos > 0) {
+    from = (pos > READ_CHUNK_SIZE) ? pos - READ_CHUNK_SIZE : 0;
+    n = pread(compiler->inputFd, buffer, pos - from, from);
+    if (n <= 0) break;
+    while (n > 0)
+      if (buffer[--n] == '\n')
+	return from + n + 1;
+    pos = from;
+  }
+  return 0;
+}
+
+void resolveStreamed(SourcePos pos, SourcePos *lineNo, SourcePos *colNo) {
+  SourcePos line = compiler->anchorLineNo;
+  SourcePos start = compiler->anchorLineStart;
+  const unsigned char *p = compiler->inputStart;
+  const unsigned char *nl;
+
+  if (pos >= compiler->inputBase) {
+    // inside the window: count forward from the anchor
+    const unsigned char *end = compiler->inputStart + (pos - compiler->inputBase);
+    while ((nl = memchr(p, '\n', end - p)) != NULL) {
+      line ++;
+      p = nl + 1;
+      start = compiler->inputBase + (p - compiler->inputStart);
+    }
+  } else {
+    // the window has already slid past pos: go back to the file
+    SourcePos count = countFileLines(pos, compiler->inputBase);
+    if (count > 0) {
+      line -= count;
+      start = findFileLineStart(pos);
+    }
+  }
+
+  *lineNo = line;
+  *colNo = pos - start + 1;
+}
+
+void resolvePosition(SourcePos pos, SourcePos *lineNo, SourcePos *colNo) {
+  if (compiler->inputKind == INPUT_STREAMED)
+    resolveStreamed(pos, lineNo, colNo);
+  else resolveIndexed(pos, lineNo, colNo);
 }
 
@@ -7,11 +7,34 @@
 #ifndef __READER_H__
 #define __READER_H__
 
+#include <stdio.h>
+
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
-int readChar(void);
+// Byte offset of a character in the source. Line and column numbers are
+// only computed from it when a diagnostic or a dump needs them.
+typedef long long SourcePos;
+
+typedef enum {
+  INPUT_MAPPED,
+  INPUT_BUFFERED,
+  INPUT_EXTERNAL,
+  INPUT_STREAMED
+} InputKind;
+
+// The reader state is in the CompilerContext, and readChar, advanceTo
+// and currentPos are in context.h
+int refillInput(void);
+
 int openInputStream(char *fileName);
+// Reads the source from a caller-owned buffer; the buffer must stay valid
+// until closeInputStream. name may be NULL.
+int openInputBuffer(const char *buffer, size_t length, const char *name);
 void closeInputStream(void);
+// Whether the whole source stays in memory until closeInputStream
+int sourceResident(void);
+
+void resolvePosition(SourcePos pos, SourcePos *lineNo, SourcePos *colNo);
 
 #endif
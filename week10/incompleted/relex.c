@@ -0,0 +1,147 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vscan.h"
+#include "dfa.h"
+#include "plex.h"
+#include "relex.h"
+
+// Text is lexed in pieces of at least this many bytes, cut after a newline
+#define RELEX_WINDOW 256
+
+void openLexedSource(LexedSource *source, const char *text, long size) {
+  source->text = NULL;
+  source->size = 0;
+  source->capacity = 0;
+  initTokenBuffer(&source->tokens);
+  editSource(source, 0, 0, text, size);
+}
+
+void closeLexedSource(LexedSource *source) {
+  free(source->text);
+  freeTokenBuffer(&source->tokens);
+  source->text = NULL;
+  source->size = 0;
+  source->capacity = 0;
+}
+
+void spliceText(LexedSource *source, long offset, long removed,
+		const char *inserted, long insertedLength) {
+  long size = source->size - removed + insertedLength;
+
+  if (size > source->capacity) {
+    source->capacity = (source->capacity * 2 > size) ? source->capacity * 2 : size;
+    source->text = (char*) realloc(source->text, source->capacity);
+  }
+  memmove(source->text + offset + insertedLength, source->text + offset + removed,
+	  source->size - offset - removed);
+  memcpy(source->text + offset, inserted, insertedLength);
+  source->size = size;
+}
+
+// End of the window that starts at p and covers at least up to 'reach'
+long windowEnd(LexedSource *source, long p, long reach) {
+  const char *nl;
+
+  if (reach < p + RELEX_WINDOW)
+    reach = p + RELEX_WINDOW;
+  if (reach >= source->size)
+    return source->size;
+  nl = memchr(source->text + reach, '\n', source->size - reach);
+  return (nl == NULL) ? source->size : nl + 1 - source->text;
+}
+
+void appendLexed(TokenBuffer *fresh, ChunkLex *chunk, long i) {
+  long j = fresh->count;
+
+  if (j == fresh->capacity)
+    reserveTokens(fresh, (j == 0) ? 64 : j * 2);
+  fresh->types[j] = chunk->tokens.types[i];
+  fresh->offsets[j] = chunk->tokens.offsets[i];
+  fresh->payloads[j] = chunk->tokens.payloads[i];
+  if (fresh->types[j] == TK_IDENT)
+    fresh->payloads[j].atom = internSpan(chunk->text + chunk->tokens.offsets[i],
+					 chunk->tokens.payloads[i].value);
+  fresh->count ++;
+}
+
+long editSource(LexedSource *source, long offset, long removed,
+		const char *inserted, long insertedLength) {
+  TokenBuffer *tokens = &source->tokens;
+  TokenBuffer fresh;
+  ChunkLex chunk;
+  long delta = insertedLength - removed;
+  long editEnd = offset + insertedLength;
+  long keep, old, tail, i, p;
+  int state = S_START;
+  int synced = 0;
+
+  spliceText(source, offset, removed, inserted, insertedLength);
+
+  // A token reads one byte past its end, so the last one before the edit
+  // may change too; error entries are not places the lexer can start from
+  keep = findToken(tokens, offset);
+  while ((keep > 0) && (tokens->types[keep - 1] == TK_NONE))
+    keep --;
+  p = 0;
+  if (keep > 0) p = tokens->offsets[--keep];
+
+  // Old tokens past the edit are candidates to line up with
+  old = findToken(tokens, offset + removed);
+
+  initTokenBuffer(&fresh);
+  while (!synced) {
+    chunk.text = (const unsigned char*) source->text;
+    chunk.from = p;
+    chunk.to = windowEnd(source, p, editEnd);
+    chunk.size = source->size;
+    chunk.startState = state;
+    chunk.recover = 1;
+    lexChunk(&chunk);
+
+    for (i = 0; i < chunk.tokens.count; i ++) {
+      // Both lexers were between tokens here and what follows is the
+      // same text, so the rest of the old list still holds
+      if ((chunk.tokens.offsets[i] >= editEnd) && (chunk.tokens.types[i] != TK_NONE)) {
+	while ((old < tokens->count) && (tokens->offsets[old] + delta < chunk.tokens.offsets[i]))
+	  old ++;
+	if ((old < tokens->count) && (tokens->offsets[old] + delta == chunk.tokens.offsets[i])
+	    && (tokens->types[old] != TK_NONE)) {
+	  synced = 1;
+	  break;
+	}
+      }
+      appendLexed(&fresh, &chunk, i);
+    }
+    freeTokenBuffer(&chunk.tokens);
+    if (chunk.exitState < 0) break;
+    p = chunk.to;
+    state = chunk.exitState;
+  }
+
+  // keep tokens, then the new ones, then the old tail moved by delta
+  tail = synced ? tokens->count - old : 0;
+  if (keep + fresh.count + tail > tokens->capacity)
+    reserveTokens(tokens, keep + fresh.count + tail);
+  memmove(tokens->types + keep + fresh.count, tokens->types + old, tail);
+  memmove(tokens->offsets + keep + fresh.count, tokens->offsets + old, tail * sizeof(SourcePos));
+  memmove(tokens->payloads + keep + fresh.count, tokens->payloads + old, tail * sizeof(TokenPayload));
+  for (i = keep + fresh.count; i < keep + fresh.count + tail; i ++)
+    tokens->offsets[i] += delta;
+  if (fresh.count > 0) {
+    memcpy(tokens->types + keep, fresh.types, fresh.count);
+    memcpy(tokens->offsets + keep, fresh.offsets, fresh.count * sizeof(SourcePos));
+    memcpy(tokens->payloads + keep, fresh.payloads, fresh.count * sizeof(TokenPayload));
+  }
+  tokens->count = keep + fresh.count + tail;
+
+  i = fresh.count;
+  freeTokenBuffer(&fresh);
+  return i;
+}
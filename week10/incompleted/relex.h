@@ -0,0 +1,35 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __RELEX_H__
+#define __RELEX_H__
+
+#include "tokbuf.h"
+
+// A source kept in memory together with its tokens, for editors that
+// change the text a little at a time. Lexical errors do not end the
+// program here: each becomes a TK_NONE entry whose payload value is the
+// ErrorCode, and lexing goes on after it. The scanner tables are built
+// by createCompiler, which must have run first.
+typedef struct {
+  char *text;
+  long size;
+  long capacity;
+  TokenBuffer tokens;
+} LexedSource;
+
+void openLexedSource(LexedSource *source, const char *text, long size);
+void closeLexedSource(LexedSource *source);
+
+// Replaces 'removed' bytes at 'offset' with 'inserted' and brings the
+// tokens up to date. Lexing starts at the last token before the edit and
+// stops as soon as a token lines up with one of the old list after the
+// edit, which is then kept with its offsets moved. Returns the number of
+// tokens lexed.
+long editSource(LexedSource *source, long offset, long removed,
+		const char *inserted, long insertedLength);
+
+#endif
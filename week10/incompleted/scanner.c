@@ -6,32 +6,88 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <ctype.h>
 
 #include "reader.h"
 #include "charcode.h"
+#include "utf8.h"
+#include "vscan.h"
 #include "token.h"
 #include "error.h"
 #include "scanner.h"
-
-
-extern int lineNo;
-extern int colNo;
-extern int currentChar;
+#include "context.h"
 
 extern CharCode charCodes[];
 
 /***************************************************************/
 
+void lexError(ErrorCode err, SourcePos pos) {
+  if (compiler->lexErrors != NULL)
+    appendError(compiler->lexErrors, err, pos);
+  else error(err, pos);
+}
+
+// Runs longer than one byte are skipped in bulk by the span kernels; the
+// loops only repeat at a window boundary
 void skipBlank() {
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
+  while ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_SPACE)) {
+    if ((compiler->inputPtr < compiler->inputEnd) && (charCodes[*compiler->inputPtr] == CHAR_SPACE))
+      advanceTo(vscanBlanks(compiler->inputPtr, compiler->inputEnd));
+    else readChar();
+  }
+}
+
+// Reads the UTF-8 sequence starting at currentChar into the four bytes of
+// buf, NUL terminated when shorter. Returns its length, or 0 if it is
+// malformed; currentChar is then left at the offending byte.
+int readUtf8Char(char *buf) {
+  int lead = compiler->currentChar;
+  int len = utf8SequenceLength(lead);
+  int i;
+
+  if (len == 0) return 0;
+  buf[0] = lead;
+  for (i = 1; i < len; i ++) {
     readChar();
+    if ((compiler->currentChar == EOF) || !utf8ValidContinuation(lead, i, compiler->currentChar))
+      return 0;
+    buf[i] = compiler->currentChar;
+  }
+  if (len < 4) buf[len] = '\0';
+  readChar();
+  return len;
+}
+
+// Skips comment text from a non-ASCII byte up to the next '*', validating
+// it as UTF-8 a block at a time
+void skipUtf8Text(void) {
+  char buf[5];
+  SourcePos pos;
+
+  advanceTo(utf8SkipText(compiler->inputPtr - 1, compiler->inputEnd));
+
+  // What is left before the next block, or across a window boundary
+  if ((compiler->currentChar != EOF) && isUtf8Byte(compiler->currentChar)) {
+    pos = currentPos();
+    if (readUtf8Char(buf) == 0) {
+      lexError(ERR_INVALID_UTF8, pos);
+      // A byte that cannot start a sequence is not read by readUtf8Char
+      if (currentPos() == pos) readChar();
+    }
+  }
 }
 
 void skipComment() {
   int state = 0;
-  while ((currentChar != EOF) && (state < 2)) {
-    switch (charCodes[currentChar]) {
+  while ((compiler->currentChar != EOF) && (state < 2)) {
+    if (isUtf8Byte(compiler->currentChar)) {
+      skipUtf8Text();
+      state = 0;
+      continue;
+    }
+    switch (charCodes[compiler->currentChar]) {
     case CHAR_TIMES:
       state = 1;
       break;
@@ -41,203 +97,297 @@ void skipComment() {
       break;
     default:
       state = 0;
+      advanceTo(vscanCommentText(compiler->inputPtr, compiler->inputEnd));
+      continue;
     }
     readChar();
   }
   if (state != 2) 
-    error(ERR_END_OF_COMMENT, lineNo, colNo);
+    lexError(ERR_END_OF_COMMENT, currentPos());
 }
 
+// A run that ends inside the window is looked up where it lies, folding
+// case on the fly; only one that continues into the next window is copied
 Token* readIdentKeyword(void) {
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
-  int count = 1;
-
-  token->string[0] = toupper((char)currentChar);
-  readChar();
+  Token *token = makeToken(TK_NONE, currentPos());
+  const unsigned char *name = compiler->inputPtr - 1;
+  const unsigned char *stop = vscanAlnum(compiler->inputPtr, compiler->inputEnd);
+  int count = stop - name;
+  char word[MAX_IDENT_LEN + 2];
+
+  if (stop == compiler->inputEnd) {
+    if (count > MAX_IDENT_LEN + 1) count = MAX_IDENT_LEN + 1;
+    memcpy(word, name, count);
+    name = (const unsigned char*) word;
+  }
+  advanceTo(stop);
 
-  while ((currentChar != EOF) && 
-	 ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT))) {
-    if (count <= MAX_IDENT_LEN) token->string[count++] = toupper((char)currentChar);
+  while ((compiler->currentChar != EOF) && 
+	 ((charCodes[compiler->currentChar] == CHAR_LETTER) || (charCodes[compiler->currentChar] == CHAR_DIGIT))) {
+    if (count <= MAX_IDENT_LEN) word[count++] = compiler->currentChar;
     readChar();
   }
 
   if (count > MAX_IDENT_LEN) {
-    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
+    lexError(ERR_IDENT_TOO_LONG, token->offset);
     return token;
   }
 
-  token->string[count] = '\0';
-  token->tokenType = checkKeyword(token->string);
+  token->length = count;
+  token->tokenType = checkKeywordSpan(name, count);
 
-  if (token->tokenType == TK_NONE)
+  if (token->tokenType == TK_NONE) {
     token->tokenType = TK_IDENT;
+    token->atom = internSpan(name, count);
+  }
 
   return token;
 }
 
 Token* readNumber(void) {
-  Token *token = makeToken(TK_NUMBER, lineNo, colNo);
-  int count = 0;
+  Token *token = makeToken(TK_NUMBER, currentPos());
+  const unsigned char *start = compiler->inputPtr - 1;
+  const unsigned char *stop = vscanDigits(compiler->inputPtr, compiler->inputEnd);
+  int count = stop - start;
+  long long value = decimalValue(start, count);
+
+  advanceTo(stop);
 
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_DIGIT)) {
-    token->string[count++] = (char)currentChar;
+  while ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_DIGIT)) {
+    if (value <= INT_MAX) value = value * 10 + (compiler->currentChar - '0');
     readChar();
   }
 
-  token->string[count] = '\0';
-  token->value = atoi(token->string);
+  if (value > INT_MAX) {
+    token->tokenType = TK_NONE;
+    lexError(ERR_NUMBER_TOO_LARGE, token->offset);
+    return token;
+  }
+  token->length = currentPos() - token->offset;
+  token->value = (int) value;
   return token;
 }
 
 Token* readConstChar(void) {
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
+  Token *token = makeToken(TK_CHAR, currentPos());
 
   readChar();
-  if (currentChar == EOF) {
+  if (compiler->currentChar == EOF) {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    lexError(ERR_INVALID_CONSTANT_CHAR, token->offset);
     return token;
   }
     
-  token->string[0] = currentChar;
-  token->string[1] = '\0';
+  if (isUtf8Byte(compiler->currentChar)) {
+    if (readUtf8Char(token->string) == 0) {
+      token->tokenType = TK_NONE;
+      lexError(ERR_INVALID_CONSTANT_CHAR, token->offset);
+      return token;
+    }
+  } else {
+    token->string[0] = compiler->currentChar;
+    token->string[1] = '\0';
+    readChar();
+  }
 
-  readChar();
-  if (currentChar == EOF) {
+  if (compiler->currentChar == EOF) {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    lexError(ERR_INVALID_CONSTANT_CHAR, token->offset);
     return token;
   }
 
-  if (charCodes[currentChar] == CHAR_SINGLEQUOTE) {
+  if (charCodes[compiler->currentChar] == CHAR_SINGLEQUOTE) {
     readChar();
+    // A CHAR holds one byte: a multi-byte character is read whole, so
+    // scanning resumes after the literal, and then rejected
+    if (isUtf8Byte((unsigned char) token->string[0])) {
+      token->tokenType = TK_NONE;
+      lexError(ERR_WIDE_CONSTANT_CHAR, token->offset);
+      return token;
+    }
+    token->length = currentPos() - token->offset;
     return token;
   } else {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    lexError(ERR_INVALID_CONSTANT_CHAR, token->offset);
     return token;
   }
 }
 
+#ifdef DFA_SCANNER
+Token* getToken(void) {
+  return getDfaToken();
+}
+#else
 Token* getToken(void) {
   Token *token;
-  int ln, cn;
+  SourcePos pos;
 
-  if (currentChar == EOF) 
-    return makeToken(TK_EOF, lineNo, colNo);
+  if (compiler->currentChar == EOF) 
+    return makeToken(TK_EOF, currentPos());
 
-  switch (charCodes[currentChar]) {
+  switch (charCodes[compiler->currentChar]) {
   case CHAR_SPACE: skipBlank(); return getToken();
   case CHAR_LETTER: return readIdentKeyword();
   case CHAR_DIGIT: return readNumber();
   case CHAR_PLUS: 
-    token = makeToken(SB_PLUS, lineNo, colNo);
+    token = makeToken(SB_PLUS, currentPos());
     readChar(); 
     return token;
   case CHAR_MINUS:
-    token = makeToken(SB_MINUS, lineNo, colNo);
+    token = makeToken(SB_MINUS, currentPos());
     readChar(); 
     return token;
   case CHAR_TIMES:
-    token = makeToken(SB_TIMES, lineNo, colNo);
+    token = makeToken(SB_TIMES, currentPos());
     readChar(); 
     return token;
   case CHAR_SLASH:
-    token = makeToken(SB_SLASH, lineNo, colNo);
+    token = makeToken(SB_SLASH, currentPos());
     readChar(); 
     return token;
   case CHAR_LT:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
+    if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_EQ)) {
       readChar();
-      return makeToken(SB_LE, ln, cn);
-    } else return makeToken(SB_LT, ln, cn);
+      return makeToken(SB_LE, pos);
+    } else return makeToken(SB_LT, pos);
   case CHAR_GT:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
+    if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_EQ)) {
       readChar();
-      return makeToken(SB_GE, ln, cn);
-    } else return makeToken(SB_GT, ln, cn);
+      return makeToken(SB_GE, pos);
+    } else return makeToken(SB_GT, pos);
   case CHAR_EQ: 
-    token = makeToken(SB_EQ, lineNo, colNo);
+    token = makeToken(SB_EQ, currentPos());
     readChar(); 
     return token;
   case CHAR_EXCLAIMATION:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
+    if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_EQ)) {
       readChar();
-      return makeToken(SB_NEQ, ln, cn);
+      return makeToken(SB_NEQ, pos);
     } else {
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALID_SYMBOL, ln, cn);
+      token = makeToken(TK_NONE, pos);
+      lexError(ERR_INVALID_SYMBOL, pos);
       return token;
     }
   case CHAR_COMMA:
-    token = makeToken(SB_COMMA, lineNo, colNo);
+    token = makeToken(SB_COMMA, currentPos());
     readChar(); 
     return token;
   case CHAR_PERIOD:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_RPAR)) {
+    if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_RPAR)) {
       readChar();
-      return makeToken(SB_RSEL, ln, cn);
-    } else return makeToken(SB_PERIOD, ln, cn);
+      return makeToken(SB_RSEL, pos);
+    } else return makeToken(SB_PERIOD, pos);
   case CHAR_SEMICOLON:
-    token = makeToken(SB_SEMICOLON, lineNo, colNo);
+    token = makeToken(SB_SEMICOLON, currentPos());
     readChar(); 
     return token;
   case CHAR_COLON:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
+    if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_EQ)) {
       readChar();
-      return makeToken(SB_ASSIGN, ln, cn);
-    } else return makeToken(SB_COLON, ln, cn);
+      return makeToken(SB_ASSIGN, pos);
+    } else return makeToken(SB_COLON, pos);
   case CHAR_SINGLEQUOTE: return readConstChar();
   case CHAR_LPAR:
-    ln = lineNo;
-    cn = colNo;
+    pos = currentPos();
     readChar();
 
-    if (currentChar == EOF) 
-      return makeToken(SB_LPAR, ln, cn);
+    if (compiler->currentChar == EOF) 
+      return makeToken(SB_LPAR, pos);
 
-    switch (charCodes[currentChar]) {
+    switch (charCodes[compiler->currentChar]) {
     case CHAR_PERIOD:
       readChar();
-      return makeToken(SB_LSEL, ln, cn);
+      return makeToken(SB_LSEL, pos);
     case CHAR_TIMES:
       readChar();
       skipComment();
       return getToken();
     default:
-      return makeToken(SB_LPAR, ln, cn);
+      return makeToken(SB_LPAR, pos);
     }
   case CHAR_RPAR:
-    token = makeToken(SB_RPAR, lineNo, colNo);
+    token = makeToken(SB_RPAR, currentPos());
     readChar(); 
     return token;
   default:
-    token = makeToken(TK_NONE, lineNo, colNo);
-    error(ERR_INVALID_SYMBOL, lineNo, colNo);
+    token = makeToken(TK_NONE, currentPos());
+    lexError(ERR_INVALID_SYMBOL, currentPos());
     readChar(); 
     return token;
   }
 }
+#endif
+
+/*
+ * Only words, comments and char constants are told apart, as that is
+ * enough to find BEGIN and END; no token is built and errors other than
+ * an unclosed comment are left for when the text is compiled.
+ */
+void skipBlockText(int depth) {
+  const unsigned char *stop;
+  TokenType tokenType;
+  char buf[4];
+  int length;
+
+  while (compiler->currentChar != EOF) {
+    switch (charCodes[compiler->currentChar]) {
+    case CHAR_SPACE:
+      skipBlank();
+      break;
+    case CHAR_LETTER:
+      stop = vscanAlnum(compiler->inputPtr, compiler->inputEnd);
+      length = stop - compiler->inputPtr + 1;
+      if ((length == 3) || (length == 5)) {
+	tokenType = checkKeywordSpan(compiler->inputPtr - 1, length);
+	if (tokenType == KW_BEGIN)
+	  depth ++;
+	else if ((tokenType == KW_END) && (-- depth == 0))
+	  return;
+      }
+      advanceTo(stop);
+      break;
+    case CHAR_DIGIT:
+      advanceTo(vscanDigits(compiler->inputPtr, compiler->inputEnd));
+      break;
+    case CHAR_LPAR:
+      readChar();
+      if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_TIMES)) {
+	readChar();
+	skipComment();
+      }
+      break;
+    case CHAR_SINGLEQUOTE:
+      // The character may itself be a quote or a parenthesis
+      readChar();
+      if (compiler->currentChar == EOF)
+	break;
+      if (!isUtf8Byte(compiler->currentChar) || (readUtf8Char(buf) == 0))
+	readChar();
+      if ((compiler->currentChar != EOF) && (charCodes[compiler->currentChar] == CHAR_SINGLEQUOTE))
+	readChar();
+      break;
+    default:
+      readChar();
+      break;
+    }
+  }
+}
 
 Token* getValidToken(void) {
   Token *token = getToken();
   while (token->tokenType == TK_NONE) {
-    free(token);
+    freeToken(token);
     token = getToken();
   }
   return token;
@@ -247,14 +397,22 @@ Token* getValidToken(void) {
 /******************************************************************/
 
 void printToken(Token *token) {
+  SourcePos lineNo, colNo;
+  char text[64];
 
-  printf("%d-%d:", token->lineNo, token->colNo);
+  resolvePosition(token->offset, &lineNo, &colNo);
+  printf("%lld-%lld:", lineNo, colNo);
 
   switch (token->tokenType) {
   case TK_NONE: printf("TK_NONE\n"); break;
-  case TK_IDENT: printf("TK_IDENT(%s)\n", token->string); break;
-  case TK_NUMBER: printf("TK_NUMBER(%s)\n", token->string); break;
-  case TK_CHAR: printf("TK_CHAR(\'%s\')\n", token->string); break;
+  case TK_IDENT: printf("TK_IDENT(%s)\n", atomName(token->atom)); break;
+  case TK_NUMBER:
+    // The source span keeps leading zeros; the value is the fallback
+    if (tokenText(token, text, sizeof(text)) != NULL)
+      printf("TK_NUMBER(%s)\n", text);
+    else printf("TK_NUMBER(%d)\n", token->value);
+    break;
+  case TK_CHAR: printf("TK_CHAR(\'%.4s\')\n", token->string); break;
   case TK_EOF: printf("TK_EOF\n"); break;
 
   case KW_PROGRAM: printf("KW_PROGRAM\n"); break;
@@ -8,9 +8,20 @@
 #define __SCANNER_H__
 
 #include "token.h"
+#include "error.h"
+
+// Reports a lexical error, or stores it while tokenizeInput runs
+void lexError(ErrorCode err, SourcePos pos);
+
+int readUtf8Char(char *buf);
+void skipUtf8Text(void);
 
 Token* getToken(void);
+Token* getDfaToken(void);
 Token* getValidToken(void);
+// Passes over source text in memory up to the END that closes depth open
+// BEGINs, which is left to be scanned next, or to the end of the input
+void skipBlockText(int depth);
 void printToken(Token *token);
 
 #endif
@@ -8,12 +8,10 @@
 #include <string.h>
 #include "semantics.h"
 #include "error.h"
+#include "context.h"
 
-extern SymTab* symtab;
-extern Token* currentToken;
-
-Object* lookupObject(char *name) {
-  Scope* scope = symtab->currentScope;
+Object* lookupObject(Atom name) {
+  Scope* scope = compiler->symtab->currentScope;
   Object* obj;
 
   while (scope != NULL) {
@@ -21,89 +19,140 @@ Object* lookupObject(char *name) {
     if (obj != NULL) return obj;
     scope = scope->outer;
   }
-  obj = findObject(symtab->globalObjectList, name);
+  obj = findObject(compiler->symtab->globalObjectList, name);
   if (obj != NULL) return obj;
   return NULL;
 }
 
-void checkFreshIdent(char *name) {
-  if (findObject(symtab->currentScope->objList, name) != NULL)
-    error(ERR_DUPLICATE_IDENT, currentToken->lineNo, currentToken->colNo);
+// Atom 0 is an identifier found missing, which has been reported already
+
+void checkFreshIdent(Atom name) {
+  if (name == 0) return;
+  if (findObject(compiler->symtab->currentScope->objList, name) != NULL)
+    error(ERR_DUPLICATE_IDENT, compiler->currentToken->offset);
 }
 
-Object* checkDeclaredIdent(char* name) {
-  Object* obj = lookupObject(name);
-  if (obj == NULL) {
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+/*
+ * An identifier that is undeclared or of the wrong kind has been reported;
+ * the checks then return a stand-in object of the kind that was expected
+ * so that compiling can go on. Its types are NULL, which the type checks
+ * accept without a word, and its parameter list takes any arguments.
+ */
+ObjectNode anyArguments = {NULL, &anyArguments};
+
+Object* errorObject(enum ObjectKind kind, Atom name) {
+  ObjectNode *node = (ObjectNode*) malloc(sizeof(ObjectNode));
+  Object* obj;
+
+  switch (kind) {
+  case OBJ_CONSTANT:
+    obj = createConstantObject(name);
+    obj->constAttrs->value = makeIntConstant(0);
+    break;
+  case OBJ_TYPE:
+    obj = createTypeObject(name);
+    obj->typeAttrs->actualType = NULL;
+    break;
+  case OBJ_FUNCTION:
+    obj = createFunctionObject(name);
+    obj->funcAttrs->paramList = &anyArguments;
+    obj->funcAttrs->returnType = NULL;
+    break;
+  case OBJ_PROCEDURE:
+    obj = createProcedureObject(name);
+    obj->procAttrs->paramList = &anyArguments;
+    break;
+  default:
+    obj = createVariableObject(name);
+    obj->varAttrs->type = NULL;
+    break;
   }
+
+  node->object = obj;
+  node->next = compiler->errorObjects;
+  compiler->errorObjects = node;
   return obj;
 }
 
-Object* checkDeclaredConstant(char* name) {
-  Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_CONSTANT,currentToken->lineNo, currentToken->colNo);
-  if (obj->kind != OBJ_CONSTANT)
-    error(ERR_INVALID_CONSTANT,currentToken->lineNo, currentToken->colNo);
+void freeErrorObjects(void) {
+  ObjectNode *node;
 
-  return obj;
+  for (node = compiler->errorObjects; node != NULL; node = node->next)
+    if (node->object->kind == OBJ_FUNCTION)
+      node->object->funcAttrs->paramList = NULL;
+    else if (node->object->kind == OBJ_PROCEDURE)
+      node->object->procAttrs->paramList = NULL;
+  freeObjectList(compiler->errorObjects);
+  compiler->errorObjects = NULL;
 }
 
-Object* checkDeclaredType(char* name) {
+Object* checkDeclaredIdent(Atom name) {
   Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_TYPE,currentToken->lineNo, currentToken->colNo);
-  if (obj->kind != OBJ_TYPE)
-    error(ERR_INVALID_TYPE,currentToken->lineNo, currentToken->colNo);
-
+  if (name == 0)
+    return errorObject(OBJ_VARIABLE, name);
+  if (obj == NULL) {
+    error(ERR_UNDECLARED_IDENT,compiler->currentToken->offset);
+    return errorObject(OBJ_VARIABLE, name);
+  }
   return obj;
 }
 
-Object* checkDeclaredVariable(char* name) {
+// The object declared as name, which must be of the given kind
+Object* checkDeclaredKind(Atom name, enum ObjectKind kind, ErrorCode undeclared, ErrorCode invalid) {
   Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_VARIABLE,currentToken->lineNo, currentToken->colNo);
-  if (obj->kind != OBJ_VARIABLE)
-    error(ERR_INVALID_VARIABLE,currentToken->lineNo, currentToken->colNo);
-
+  if (name == 0)
+    return errorObject(kind, name);
+  if (obj == NULL) {
+    error(undeclared, compiler->currentToken->offset);
+    return errorObject(kind, name);
+  }
+  if (obj->kind != kind) {
+    error(invalid, compiler->currentToken->offset);
+    return errorObject(kind, name);
+  }
   return obj;
 }
 
-Object* checkDeclaredFunction(char* name) {
-  Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_FUNCTION,currentToken->lineNo, currentToken->colNo);
-  if (obj->kind != OBJ_FUNCTION)
-    error(ERR_INVALID_FUNCTION,currentToken->lineNo, currentToken->colNo);
+Object* checkDeclaredConstant(Atom name) {
+  return checkDeclaredKind(name, OBJ_CONSTANT, ERR_UNDECLARED_CONSTANT, ERR_INVALID_CONSTANT);
+}
 
-  return obj;
+Object* checkDeclaredType(Atom name) {
+  return checkDeclaredKind(name, OBJ_TYPE, ERR_UNDECLARED_TYPE, ERR_INVALID_TYPE);
 }
 
-Object* checkDeclaredProcedure(char* name) {
-  Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_PROCEDURE,currentToken->lineNo, currentToken->colNo);
-  if (obj->kind != OBJ_PROCEDURE)
-    error(ERR_INVALID_PROCEDURE,currentToken->lineNo, currentToken->colNo);
+Object* checkDeclaredVariable(Atom name) {
+  return checkDeclaredKind(name, OBJ_VARIABLE, ERR_UNDECLARED_VARIABLE, ERR_INVALID_VARIABLE);
+}
 
-  return obj;
+Object* checkDeclaredFunction(Atom name) {
+  return checkDeclaredKind(name, OBJ_FUNCTION, ERR_UNDECLARED_FUNCTION, ERR_INVALID_FUNCTION);
 }
 
-Object* checkDeclaredLValueIdent(char* name) {
+Object* checkDeclaredProcedure(Atom name) {
+  return checkDeclaredKind(name, OBJ_PROCEDURE, ERR_UNDECLARED_PROCEDURE, ERR_INVALID_PROCEDURE);
+}
+
+Object* checkDeclaredLValueIdent(Atom name) {
   Object* obj = lookupObject(name);
-  if (obj == NULL)
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+  if (name == 0)
+    return errorObject(OBJ_VARIABLE, name);
+  if (obj == NULL) {
+    error(ERR_UNDECLARED_IDENT,compiler->currentToken->offset);
+    return errorObject(OBJ_VARIABLE, name);
+  }
 
   switch (obj->kind) {
   case OBJ_VARIABLE:
   case OBJ_PARAMETER:
     break;
   case OBJ_FUNCTION:
-    if (obj != symtab->currentScope->owner) 
-      error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+    if (obj != compiler->symtab->currentScope->owner) 
+      error(ERR_INVALID_IDENT,compiler->currentToken->offset);
     break;
   default:
-    error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_IDENT,compiler->currentToken->offset);
+    return errorObject(OBJ_VARIABLE, name);
   }
 
   return obj;
@@ -111,39 +160,35 @@ Object* checkDeclaredLValueIdent(char* name) {
 
 void checkIntType(Type* type) {
   // CuongDD: Check the Integer Type
-  if (type->typeClass != TP_INT) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+  if ((type != NULL) && (type->typeClass != TP_INT)) {
+    error(ERR_TYPE_INCONSISTENCY, compiler->currentToken->offset);
   }
 }
 
 void checkCharType(Type* type) {
-  if (type->typeClass != TP_CHAR) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+  if ((type != NULL) && (type->typeClass != TP_CHAR)) {
+    error(ERR_TYPE_INCONSISTENCY, compiler->currentToken->offset);
   }
 }
 
 void checkBasicType(Type* type) {
-  if (type->typeClass != TP_INT && type->typeClass != TP_CHAR) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+  if ((type != NULL) && type->typeClass != TP_INT && type->typeClass != TP_CHAR) {
+    error(ERR_TYPE_INCONSISTENCY, compiler->currentToken->offset);
   }
 }
 
 void checkArrayType(Type* type) {
-  if (type->typeClass != TP_ARRAY) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+  if ((type != NULL) && (type->typeClass != TP_ARRAY)) {
+    error(ERR_TYPE_INCONSISTENCY, compiler->currentToken->offset);
   }
 }
 
 void checkTypeEquality(Type* type1, Type* type2) {
-  // If two type do not have same elementType, they are not equal
-  if (type1->elementType != type2->elementType) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-  } // Otherwise, check if they are array
-  else if(type1->typeClass == TP_ARRAY) {
-    checkTypeEquality(type1->elementType, type2->elementType);
-    if (type1->arraySize != type2->arraySize) {
-      error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-    }
+  // compareType follows the element types of arrays; basic types leave
+  // elementType unset, so it must not be compared directly. A NULL type
+  // comes from an error already reported.
+  if ((type1 != NULL) && (type2 != NULL) && (compareType(type1, type2) == 0)) {
+    error(ERR_TYPE_INCONSISTENCY, compiler->currentToken->offset);
   }
 }
 
@@ -9,14 +9,19 @@
 
 #include "symtab.h"
 
-void checkFreshIdent(char *name);
-Object* checkDeclaredIdent(char *name);
-Object* checkDeclaredConstant(char *name);
-Object* checkDeclaredType(char *name);
-Object* checkDeclaredVariable(char *name);
-Object* checkDeclaredFunction(char *name);
-Object* checkDeclaredProcedure(char *name);
-Object* checkDeclaredLValueIdent(char *name);
+// Parameter list of a stand-in for an undeclared function or procedure,
+// matching any arguments
+extern ObjectNode anyArguments;
+void freeErrorObjects(void);
+
+void checkFreshIdent(Atom name);
+Object* checkDeclaredIdent(Atom name);
+Object* checkDeclaredConstant(Atom name);
+Object* checkDeclaredType(Atom name);
+Object* checkDeclaredVariable(Atom name);
+Object* checkDeclaredFunction(Atom name);
+Object* checkDeclaredProcedure(Atom name);
+Object* checkDeclaredLValueIdent(Atom name);
 
 void checkIntType(Type* type);
 void checkCharType(Type* type);
@@ -9,16 +9,13 @@
 #include <string.h>
 #include "symtab.h"
 #include "error.h"
+#include "context.h"
 
 void freeObject(Object* obj);
 void freeScope(Scope* scope);
 void freeObjectList(ObjectNode *objList);
 void freeReferenceList(ObjectNode *objList);
 
-SymTab* symtab;
-Type* intType;
-Type* charType;
-
 /******************* Type utilities ******************************/
 
 Type* makeIntType(void) {
@@ -42,7 +39,10 @@ Type* makeArrayType(int arraySize, Type* elementType) {
 }
 
 Type* duplicateType(Type* type) {
-  Type* resultType = (Type*) malloc(sizeof(Type));
+  Type* resultType;
+
+  if (type == NULL) return NULL;
+  resultType = (Type*) malloc(sizeof(Type));
   resultType->typeClass = type->typeClass;
   if (type->typeClass == TP_ARRAY) {
     resultType->arraySize = type->arraySize;
@@ -62,6 +62,7 @@ int compareType(Type* type1, Type* type2) {
 }
 
 void freeType(Type* type) {
+  if (type == NULL) return;
   switch (type->typeClass) {
   case TP_INT:
   case TP_CHAR:
@@ -69,7 +70,7 @@ void freeType(Type* type) {
     break;
   case TP_ARRAY:
     freeType(type->elementType);
-    freeType(type);
+    free(type);
     break;
   }
 }
@@ -102,6 +103,9 @@ ConstantValue* duplicateConstantValue(ConstantValue* v) {
 
 /******************* Object utilities ******************************/
 
+// Pointers in the attributes start out NULL, so that an object left half
+// built when an error ends the compilation can still be freed
+
 Scope* createScope(Object* owner, Scope* outer) {
   Scope* scope = (Scope*) malloc(sizeof(Scope));
   scope->objList = NULL;
@@ -110,69 +114,74 @@ Scope* createScope(Object* owner, Scope* outer) {
   return scope;
 }
 
-Object* createProgramObject(char *programName) {
+Object* createProgramObject(Atom programName) {
   Object* program = (Object*) malloc(sizeof(Object));
-  strcpy(program->name, programName);
+  program->name = programName;
   program->kind = OBJ_PROGRAM;
   program->progAttrs = (ProgramAttributes*) malloc(sizeof(ProgramAttributes));
   program->progAttrs->scope = createScope(program,NULL);
-  symtab->program = program;
+  compiler->symtab->program = program;
 
   return program;
 }
 
-Object* createConstantObject(char *name) {
+Object* createConstantObject(Atom name) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_CONSTANT;
   obj->constAttrs = (ConstantAttributes*) malloc(sizeof(ConstantAttributes));
+  obj->constAttrs->value = NULL;
   return obj;
 }
 
-Object* createTypeObject(char *name) {
+Object* createTypeObject(Atom name) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_TYPE;
   obj->typeAttrs = (TypeAttributes*) malloc(sizeof(TypeAttributes));
+  obj->typeAttrs->actualType = NULL;
   return obj;
 }
 
-Object* createVariableObject(char *name) {
+Object* createVariableObject(Atom name) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_VARIABLE;
   obj->varAttrs = (VariableAttributes*) malloc(sizeof(VariableAttributes));
-  obj->varAttrs->scope = symtab->currentScope;
+  obj->varAttrs->type = NULL;
+  obj->varAttrs->scope = compiler->symtab->currentScope;
   return obj;
 }
 
-Object* createFunctionObject(char *name) {
+Object* createFunctionObject(Atom name) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_FUNCTION;
   obj->funcAttrs = (FunctionAttributes*) malloc(sizeof(FunctionAttributes));
   obj->funcAttrs->paramList = NULL;
-  obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
+  obj->funcAttrs->returnType = NULL;
+  obj->funcAttrs->scope = createScope(obj, compiler->symtab->currentScope);
   return obj;
 }
 
-Object* createProcedureObject(char *name) {
+Object* createProcedureObject(Atom name) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_PROCEDURE;
   obj->procAttrs = (ProcedureAttributes*) malloc(sizeof(ProcedureAttributes));
   obj->procAttrs->paramList = NULL;
-  obj->procAttrs->scope = createScope(obj, symtab->currentScope);
+  obj->procAttrs->scope = createScope(obj, compiler->symtab->currentScope);
   return obj;
 }
 
-Object* createParameterObject(char *name, enum ParamKind kind, Object* owner) {
+Object* createParameterObject(Atom name, enum ParamKind kind, Object* owner) {
   Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  obj->name = name;
   obj->kind = OBJ_PARAMETER;
   obj->paramAttrs = (ParameterAttributes*) malloc(sizeof(ParameterAttributes));
   obj->paramAttrs->kind = kind;
   obj->paramAttrs->function = owner;
+  obj->paramAttrs->type = NULL;
   return obj;
 }
 
@@ -252,9 +261,10 @@ void addObject(ObjectNode **objList, Object* obj) {
   }
 }
 
-Object* findObject(ObjectNode *objList, char *name) {
+// Names are atoms, so equal names are the same number
+Object* findObject(ObjectNode *objList, Atom name) {
   while (objList != NULL) {
-    if (strcmp(objList->object->name, name) == 0) 
+    if (objList->object->name == name) 
       return objList->object;
     else objList = objList->next;
   }
@@ -267,55 +277,60 @@ void initSymTab(void) {
   Object* obj;
   Object* param;
 
-  symtab = (SymTab*) malloc(sizeof(SymTab));
-  symtab->globalObjectList = NULL;
+  compiler->symtab = (SymTab*) malloc(sizeof(SymTab));
+  compiler->symtab->program = NULL;
+  compiler->symtab->globalObjectList = NULL;
   
-  obj = createFunctionObject("READC");
+  obj = createFunctionObject(internString("READC"));
   obj->funcAttrs->returnType = makeCharType();
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(compiler->symtab->globalObjectList), obj);
 
-  obj = createFunctionObject("READI");
+  obj = createFunctionObject(internString("READI"));
   obj->funcAttrs->returnType = makeIntType();
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(compiler->symtab->globalObjectList), obj);
 
-  obj = createProcedureObject("WRITEI");
-  param = createParameterObject("i", PARAM_VALUE, obj);
+  obj = createProcedureObject(internString("WRITEI"));
+  param = createParameterObject(internString("i"), PARAM_VALUE, obj);
   param->paramAttrs->type = makeIntType();
   addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(compiler->symtab->globalObjectList), obj);
 
-  obj = createProcedureObject("WRITEC");
-  param = createParameterObject("ch", PARAM_VALUE, obj);
+  obj = createProcedureObject(internString("WRITEC"));
+  param = createParameterObject(internString("ch"), PARAM_VALUE, obj);
   param->paramAttrs->type = makeCharType();
   addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(compiler->symtab->globalObjectList), obj);
 
-  obj = createProcedureObject("WRITELN");
-  addObject(&(symtab->globalObjectList), obj);
+  obj = createProcedureObject(internString("WRITELN"));
+  addObject(&(compiler->symtab->globalObjectList), obj);
 
-  intType = makeIntType();
-  charType = makeCharType();
+  compiler->intType = makeIntType();
+  compiler->charType = makeCharType();
 }
 
 void cleanSymTab(void) {
-  freeObject(symtab->program);
-  freeObjectList(symtab->globalObjectList);
-  free(symtab);
-  freeType(intType);
-  freeType(charType);
+  if (compiler->symtab == NULL)
+    return;
+  if (compiler->symtab->program != NULL)
+    freeObject(compiler->symtab->program);
+  freeObjectList(compiler->symtab->globalObjectList);
+  free(compiler->symtab);
+  freeType(compiler->intType);
+  freeType(compiler->charType);
+  compiler->symtab = NULL;
 }
 
 void enterBlock(Scope* scope) {
-  symtab->currentScope = scope;
+  compiler->symtab->currentScope = scope;
 }
 
 void exitBlock(void) {
-  symtab->currentScope = symtab->currentScope->outer;
+  compiler->symtab->currentScope = compiler->symtab->currentScope->outer;
 }
 
 void declareObject(Object* obj) {
   if (obj->kind == OBJ_PARAMETER) {
-    Object* owner = symtab->currentScope->owner;
+    Object* owner = compiler->symtab->currentScope->owner;
     switch (owner->kind) {
     case OBJ_FUNCTION:
       addObject(&(owner->funcAttrs->paramList), obj);
@@ -328,7 +343,7 @@ void declareObject(Object* obj) {
     }
   }
  
-  addObject(&(symtab->currentScope->objList), obj);
+  addObject(&(compiler->symtab->currentScope->objList), obj);
 }
 
 
@@ -97,7 +97,7 @@ typedef struct ProgramAttributes_ ProgramAttributes;
 typedef struct ParameterAttributes_ ParameterAttributes;
 
 struct Object_ {
-  char name[MAX_IDENT_LEN];
+  Atom name;
   enum ObjectKind kind;
   union {
     ConstantAttributes* constAttrs;
@@ -148,15 +148,16 @@ ConstantValue* duplicateConstantValue(ConstantValue* v);
 
 Scope* createScope(Object* owner, Scope* outer);
 
-Object* createProgramObject(char *programName);
-Object* createConstantObject(char *name);
-Object* createTypeObject(char *name);
-Object* createVariableObject(char *name);
-Object* createFunctionObject(char *name);
-Object* createProcedureObject(char *name);
-Object* createParameterObject(char *name, enum ParamKind kind, Object* owner);
+Object* createProgramObject(Atom programName);
+Object* createConstantObject(Atom name);
+Object* createTypeObject(Atom name);
+Object* createVariableObject(Atom name);
+Object* createFunctionObject(Atom name);
+Object* createProcedureObject(Atom name);
+Object* createParameterObject(Atom name, enum ParamKind kind, Object* owner);
 
-Object* findObject(ObjectNode *objList, char *name);
+Object* findObject(ObjectNode *objList, Atom name);
+void freeObjectList(ObjectNode *objList);
 
 void initSymTab(void);
 void cleanSymTab(void);
@@ -0,0 +1,253 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "tkcache.h"
+#include "context.h"
+
+#define TOKEN_CACHE_MAGIC 0x544c504bu       // "KPLT" when little endian
+#define TOKEN_CACHE_VERSION 2
+
+// The header is followed by the arrays of the buffer and then by the
+// atom names, NUL terminated and in atom order, each part starting on an
+// 8-byte boundary
+typedef struct {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int offsetSize;
+  unsigned int payloadSize;
+  unsigned long long sourceHash;
+  long long sourceSize;
+  long long tokenCount;
+  long long atomCount;
+  long long typesAt, offsetsAt, payloadsAt, namesAt;
+  long long fileSize;
+} CacheHeader;
+
+#define ALIGN8(n) (((n) + 7) & ~7LL)
+
+// 64-bit hash of the source, a word at a time
+unsigned long long hashSource(const unsigned char *p, long size) {
+  unsigned long long h = 0x9e3779b97f4a7c15ULL ^ size;
+  unsigned long long word;
+  long i;
+
+  for (i = 0; i + 8 <= size; i += 8) {
+    memcpy(&word, p + i, 8);
+    h = (h ^ word) * 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+  }
+  for (; i < size; i ++)
+    h = (h ^ p[i]) * 0x100000001b3ULL;
+  h ^= h >> 29;
+  return h * 0xc4ceb9fe1a85ec53ULL;
+}
+
+void cachePath(char *path, size_t size, const char *dir, unsigned long long hash) {
+  snprintf(path, size, "%s/%016llx.tkc", dir, hash);
+}
+
+int loadTokenCache(TokenBuffer *buffer, const char *dir) {
+  long size = compiler->inputEnd - compiler->inputStart;
+  unsigned long long hash;
+  char path[4096];
+  CacheHeader *header;
+  struct stat st;
+  unsigned char *file;
+  const char *name, *namesEnd;
+  Atom *atomMap = NULL;
+  long long i;
+  int fd, remap = 0;
+
+  if (!sourceResident())
+    return 0;
+  hash = hashSource(compiler->inputStart, size);
+  cachePath(path, sizeof(path), dir, hash);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  if ((fstat(fd, &st) < 0) || (st.st_size < (off_t) sizeof(CacheHeader))) {
+    close(fd);
+    return 0;
+  }
+  // Private and writable, so that atoms can be renumbered in place
+  file = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (file == MAP_FAILED)
+    return 0;
+
+  header = (CacheHeader*) file;
+  if ((header->magic != TOKEN_CACHE_MAGIC) || (header->version != TOKEN_CACHE_VERSION) ||
+      (header->offsetSize != sizeof(SourcePos)) || (header->payloadSize != sizeof(TokenPayload)) ||
+      (header->sourceHash != hash) || (header->sourceSize != size) ||
+      (header->fileSize != st.st_size) ||
+      // Bounded first, so that the sums below cannot overflow
+      (header->tokenCount <= 0) || (header->tokenCount > header->fileSize) ||
+      (header->typesAt < (long long) ALIGN8(sizeof(CacheHeader))) || (header->typesAt > header->fileSize) ||
+      (header->offsetsAt > header->fileSize) || (header->payloadsAt > header->fileSize) ||
+      (header->offsetsAt % 8 != 0) || (header->payloadsAt % 8 != 0) ||
+      (header->namesAt > header->fileSize) ||
+      (header->typesAt + header->tokenCount > header->offsetsAt) ||
+      (header->offsetsAt + header->tokenCount * (long long) sizeof(SourcePos) > header->payloadsAt) ||
+      (header->payloadsAt + header->tokenCount * (long long) sizeof(TokenPayload) > header->namesAt) ||
+      // Each name takes at least its terminating NUL
+      (header->atomCount < 0) || (header->atomCount > header->fileSize - header->namesAt) ||
+      ((header->namesAt < header->fileSize) && (file[header->fileSize - 1] != '\0')) ||
+      (file[header->typesAt + header->tokenCount - 1] != TK_EOF)) {
+    munmap(file, st.st_size);
+    return 0;
+  }
+
+  // The names are interned in the order they were numbered; in a fresh
+  // run they get the same numbers and the tokens are used as they are
+  atomMap = (Atom*) malloc((header->atomCount + 1) * sizeof(Atom));
+  if (atomMap == NULL) {
+    munmap(file, st.st_size);
+    return 0;
+  }
+  atomMap[0] = 0;
+  name = (const char*) file + header->namesAt;
+  namesEnd = (const char*) file + header->fileSize;
+  for (i = 1; i <= header->atomCount; i ++) {
+    if (name >= namesEnd) {
+      free(atomMap);
+      munmap(file, st.st_size);
+      return 0;
+    }
+    atomMap[i] = internString(name);
+    if (atomMap[i] != i) remap = 1;
+    name += strlen(name) + 1;
+  }
+
+  buffer->types = file + header->typesAt;
+  buffer->offsets = (SourcePos*) (file + header->offsetsAt);
+  buffer->payloads = (TokenPayload*) (file + header->payloadsAt);
+  buffer->count = buffer->capacity = header->tokenCount;
+  buffer->mapping = file;
+  buffer->mappingSize = st.st_size;
+
+  // Only a file that could have been saved is used: every token has a
+  // type the parser knows and lies in the source, after the one before it.
+  // A lexical error may share its offset with the next token, and the end
+  // of a comment error with TK_EOF.
+  for (i = 0; i < buffer->count; i ++) {
+    if ((buffer->types[i] > SB_RSEL) ||
+	((buffer->types[i] == TK_NONE) &&
+	 ((buffer->payloads[i].value < ERR_END_OF_COMMENT) || (buffer->payloads[i].value > ERR_WIDE_CONSTANT_CHAR))) ||
+	((i > 0) && (buffer->offsets[i] < buffer->offsets[i - 1])) ||
+	((i > 0) && (buffer->offsets[i] == buffer->offsets[i - 1]) && (buffer->types[i - 1] != TK_NONE)) ||
+	(buffer->offsets[i] < 0) || (buffer->offsets[i] > size) ||
+	((buffer->offsets[i] == size) && (buffer->types[i] != TK_EOF) && (buffer->types[i] != TK_NONE)) ||
+	((buffer->types[i] == TK_IDENT) && (buffer->payloads[i].atom > header->atomCount))) {
+      free(atomMap);
+      freeTokenBuffer(buffer);
+      return 0;
+    }
+    if ((buffer->types[i] == TK_IDENT) && remap)
+      buffer->payloads[i].atom = atomMap[buffer->payloads[i].atom];
+  }
+  free(atomMap);
+
+  advanceTo(compiler->inputEnd);
+  return 1;
+}
+
+void writePadded(FILE *f, const void *data, long long size) {
+  static const char zeros[8];
+
+  fwrite(data, 1, size, f);
+  fwrite(zeros, 1, ALIGN8(size) - size, f);
+}
+
+int saveTokenCache(TokenBuffer *buffer, const char *dir) {
+  char path[4096], tmpPath[4096 + 32];
+  CacheHeader header;
+  long long namesSize = 0;
+  FILE *f;
+  int i;
+
+  if (!sourceResident())
+    return IO_ERROR;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = TOKEN_CACHE_MAGIC;
+  header.version = TOKEN_CACHE_VERSION;
+  header.offsetSize = sizeof(SourcePos);
+  header.payloadSize = sizeof(TokenPayload);
+  header.sourceSize = compiler->inputEnd - compiler->inputStart;
+  header.sourceHash = hashSource(compiler->inputStart, header.sourceSize);
+  header.tokenCount = buffer->count;
+  header.atomCount = compiler->atomCount;
+  for (i = 1; i <= compiler->atomCount; i ++)
+    namesSize += strlen(compiler->atomNames[i]) + 1;
+  header.typesAt = ALIGN8(sizeof(header));
+  header.offsetsAt = header.typesAt + ALIGN8(buffer->count);
+  header.payloadsAt = header.offsetsAt + ALIGN8(buffer->count * sizeof(SourcePos));
+  header.namesAt = header.payloadsAt + ALIGN8(buffer->count * sizeof(TokenPayload));
+  header.fileSize = header.namesAt + namesSize;
+
+  // Written aside and renamed, so a reader never sees half a file
+  cachePath(path, sizeof(path), dir, header.sourceHash);
+  snprintf(tmpPath, sizeof(tmpPath), "%s.%d", path, (int) getpid());
+  f = fopen(tmpPath, "wb");
+  if (f == NULL)
+    return IO_ERROR;
+
+  writePadded(f, &header, sizeof(header));
+  writePadded(f, buffer->types, buffer->count);
+  writePadded(f, buffer->offsets, buffer->count * sizeof(SourcePos));
+  writePadded(f, buffer->payloads, buffer->count * sizeof(TokenPayload));
+  for (i = 1; i <= compiler->atomCount; i ++)
+    fwrite(compiler->atomNames[i], 1, strlen(compiler->atomNames[i]) + 1, f);
+  if (ferror(f)) {
+    fclose(f);
+    unlink(tmpPath);
+    return IO_ERROR;
+  }
+  if (fclose(f) != 0) {
+    unlink(tmpPath);
+    return IO_ERROR;
+  }
+  if (rename(tmpPath, path) != 0) {
+    unlink(tmpPath);
+    return IO_ERROR;
+  }
+  return IO_SUCCESS;
+}
+
+long compareTokens(TokenBuffer *a, TokenBuffer *b) {
+  long i;
+
+  for (i = 0; (i < a->count) && (i < b->count); i ++) {
+    if ((a->types[i] != b->types[i]) || (a->offsets[i] != b->offsets[i]))
+      return i;
+    switch (a->types[i]) {
+    case TK_IDENT:
+      if (a->payloads[i].atom != b->payloads[i].atom) return i;
+      break;
+    case TK_NONE:
+    case TK_NUMBER:
+      if (a->payloads[i].value != b->payloads[i].value) return i;
+      break;
+    case TK_CHAR:
+      if (strncmp(a->payloads[i].text, b->payloads[i].text, sizeof(a->payloads[i].text)) != 0)
+	return i;
+      break;
+    default:
+      break;
+    }
+  }
+  return (a->count == b->count) ? -1 : i;
+}
@@ -0,0 +1,30 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __TKCACHE_H__
+#define __TKCACHE_H__
+
+#include "tokbuf.h"
+
+// Token caches keep the tokens of a source in a file of 'dir' named by a
+// hash of the source text, so that an unchanged source is not scanned
+// again. The files are in the byte order and layout of the machine that
+// wrote them; anything else is rejected by the header check. Lexical
+// errors are kept as the TK_NONE entries of the buffer, so a unit loaded
+// from its cache reports them again.
+
+// Fills buffer, which must be empty, from the cache file of the open
+// input and leaves the reader at the end. Returns 0, reading nothing, when
+// the input is streamed or there is no valid cache file for it.
+int loadTokenCache(TokenBuffer *buffer, const char *dir);
+
+// Writes buffer, the tokens of the whole open input, to its cache file
+int saveTokenCache(TokenBuffer *buffer, const char *dir);
+
+// Index of the first token where a and b differ, or -1 if they are the same
+long compareTokens(TokenBuffer *a, TokenBuffer *b);
+
+#endif
@@ -0,0 +1,140 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "scanner.h"
+#include "tokbuf.h"
+#include "context.h"
+
+#define INITIAL_TOKEN_CAPACITY 1024
+
+void initTokenBuffer(TokenBuffer *buffer) {
+  buffer->types = NULL;
+  buffer->offsets = NULL;
+  buffer->payloads = NULL;
+  buffer->count = 0;
+  buffer->capacity = 0;
+  buffer->mapping = NULL;
+  buffer->mappingSize = 0;
+}
+
+void freeTokenBuffer(TokenBuffer *buffer) {
+  if (buffer->mapping != NULL)
+    munmap(buffer->mapping, buffer->mappingSize);
+  else {
+    free(buffer->types);
+    free(buffer->offsets);
+    free(buffer->payloads);
+  }
+  initTokenBuffer(buffer);
+}
+
+void reserveTokens(TokenBuffer *buffer, long capacity) {
+  buffer->types = (unsigned char*) realloc(buffer->types, capacity);
+  buffer->offsets = (SourcePos*) realloc(buffer->offsets, capacity * sizeof(SourcePos));
+  buffer->payloads = (TokenPayload*) realloc(buffer->payloads, capacity * sizeof(TokenPayload));
+  buffer->capacity = capacity;
+}
+
+void growTokenBuffer(TokenBuffer *buffer) {
+  reserveTokens(buffer, (buffer->capacity == 0) ? INITIAL_TOKEN_CAPACITY : buffer->capacity * 2);
+}
+
+void appendToken(TokenBuffer *buffer, Token *token) {
+  long i = buffer->count;
+
+  if (i == buffer->capacity)
+    growTokenBuffer(buffer);
+
+  buffer->types[i] = token->tokenType;
+  buffer->offsets[i] = token->offset;
+  // Bytes past the character and the payloads of other tokens are zero,
+  // as the buffer goes as it is into cache files
+  switch (token->tokenType) {
+  case TK_IDENT:
+    buffer->payloads[i].atom = token->atom;
+    break;
+  case TK_NUMBER:
+    buffer->payloads[i].value = token->value;
+    break;
+  case TK_CHAR:
+    buffer->payloads[i].value = 0;
+    memcpy(buffer->payloads[i].text, token->string, strlen(token->string) + 1);
+    break;
+  default:
+    buffer->payloads[i].value = 0;
+    break;
+  }
+  buffer->count ++;
+}
+
+// Sources average well over four bytes a token; sizing the arrays from the
+// resident input saves most of the copying as they grow
+#define BYTES_PER_TOKEN 4
+
+void appendError(TokenBuffer *buffer, ErrorCode err, SourcePos offset) {
+  long i = buffer->count;
+
+  if (i == buffer->capacity)
+    growTokenBuffer(buffer);
+
+  buffer->types[i] = TK_NONE;
+  buffer->offsets[i] = offset;
+  buffer->payloads[i].value = err;
+  buffer->count ++;
+}
+
+long tokenizeInput(TokenBuffer *buffer) {
+  Token *token;
+  long expected = buffer->count + (compiler->inputEnd - compiler->inputPtr) / BYTES_PER_TOKEN + 1;
+
+  if (expected > buffer->capacity)
+    reserveTokens(buffer, expected);
+
+  compiler->lexErrors = buffer;
+  do {
+    token = getToken();
+    if (token->tokenType != TK_NONE)
+      appendToken(buffer, token);
+    freeToken(token);
+  } while ((buffer->count == 0) || (buffer->types[buffer->count - 1] != TK_EOF));
+  compiler->lexErrors = NULL;
+  return buffer->count;
+}
+
+Token* bufferedToken(TokenBuffer *buffer, long i) {
+  Token *token = makeToken(buffer->types[i], buffer->offsets[i]);
+
+  switch (token->tokenType) {
+  case TK_IDENT:
+    token->atom = buffer->payloads[i].atom;
+    break;
+  case TK_NUMBER:
+    token->value = buffer->payloads[i].value;
+    break;
+  case TK_CHAR:
+    memcpy(token->string, buffer->payloads[i].text, sizeof(token->string));
+    break;
+  default:
+    break;
+  }
+  return token;
+}
+
+long findToken(TokenBuffer *buffer, SourcePos offset) {
+  long low = 0, high = buffer->count;
+  long middle;
+
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    if (buffer->offsets[middle] < offset)
+      low = middle + 1;
+    else high = middle;
+  }
+  return low;
+}
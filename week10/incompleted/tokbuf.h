@@ -0,0 +1,45 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __TOKBUF_H__
+#define __TOKBUF_H__
+
+#include "token.h"
+#include "error.h"
+
+// A whole unit of tokens held as parallel arrays, in source order and
+// ending with TK_EOF
+typedef struct {
+  unsigned char *types;
+  SourcePos *offsets;
+  TokenPayload *payloads;
+  long count;
+  long capacity;
+  // Set when the arrays lie in a mapped token cache; such a buffer cannot
+  // grow
+  void *mapping;
+  size_t mappingSize;
+} TokenBuffer;
+
+void initTokenBuffer(TokenBuffer *buffer);
+void freeTokenBuffer(TokenBuffer *buffer);
+void reserveTokens(TokenBuffer *buffer, long capacity);
+void appendToken(TokenBuffer *buffer, Token *token);
+// Appends a lexical error: a TK_NONE entry whose payload value is err
+void appendError(TokenBuffer *buffer, ErrorCode err, SourcePos offset);
+
+// Scans the open input to the end. Lexical errors are stored as by
+// appendError, where they occur, rather than reported; the TK_NONE tokens
+// the scanner returns after them are dropped. Returns the number of
+// entries stored.
+long tokenizeInput(TokenBuffer *buffer);
+
+// Rebuilds token i as a Token from the pool, to be released with freeToken
+Token* bufferedToken(TokenBuffer *buffer, long i);
+// Index of the first token at or after offset, count when there is none
+long findToken(TokenBuffer *buffer, SourcePos offset);
+
+#endif
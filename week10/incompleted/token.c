@@ -6,7 +6,8 @@
 
 #include <stdlib.h>
 #include <ctype.h>
-#include "token.h"
+#include <string.h>
+#include "context.h"
 
 struct {
   char string[MAX_IDENT_LEN + 1];
@@ -34,30 +35,111 @@ struct {
   {"TO", KW_TO}
 };
 
-int keywordEq(char *kw, char *string) {
-  while ((*kw != '\0') && (*string != '\0')) {
-    if (*kw != *string) break;
-    kw ++; string ++;
-  }
-  return ((*kw == '\0') && (*string == '\0'));
+/*
+ * Perfect hash over the keywords: length, first and last character are
+ * enough to give each of them its own slot, so a lookup costs one hash and
+ * one final comparison. KEYWORD_SLOTS must be a power of two.
+ */
+#define KEYWORD_SLOTS 64
+#define MAX_KEYWORD_LEN 9
+
+#define keywordHash(s, len) \
+  (((len) + (unsigned char) (s)[0] + 19 * (unsigned char) (s)[(len) - 1]) & (KEYWORD_SLOTS - 1))
+
+int keywordSlots[KEYWORD_SLOTS];
+
+void buildKeywordSlots(void) {
+  int i;
+  for (i = 0; i < KEYWORD_SLOTS; i++)
+    keywordSlots[i] = -1;
+  for (i = 0; i < KEYWORDS_COUNT; i++)
+    keywordSlots[keywordHash(keywords[i].string, strlen(keywords[i].string))] = i;
+}
+
+TokenType checkKeywordSpan(const unsigned char *text, int length) {
+  const char *keyword;
+  int slot, i;
+
+  if ((length < 2) || (length > MAX_KEYWORD_LEN))
+    return TK_NONE;
+
+  slot = keywordSlots[(length + upperAscii(text[0]) + 19 * upperAscii(text[length - 1])) & (KEYWORD_SLOTS - 1)];
+  if (slot < 0)
+    return TK_NONE;
+  keyword = keywords[slot].string;
+  for (i = 0; i < length; i ++)
+    if (keyword[i] != upperAscii(text[i])) return TK_NONE;
+  return (keyword[length] == '\0') ? keywords[slot].tokenType : TK_NONE;
 }
 
 TokenType checkKeyword(char *string) {
+  return checkKeywordSpan((const unsigned char*) string, strlen(string));
+}
+
+// Freed tokens are kept on a list and handed out again; new slots are
+// allocated TOKEN_BLOCK_SIZE at a time. The first slot of a block links
+// it to the block allocated before.
+#define TOKEN_BLOCK_SIZE 64
+
+void growTokenPool(void) {
+  TokenSlot *block = (TokenSlot*) malloc(TOKEN_BLOCK_SIZE * sizeof(TokenSlot));
   int i;
-  for (i = 0; i < KEYWORDS_COUNT; i++)
-    if (keywordEq(keywords[i].string, string)) 
-      return keywords[i].tokenType;
-  return TK_NONE;
+
+  block[0].next = compiler->tokenBlocks;
+  compiler->tokenBlocks = block;
+  for (i = 1; i < TOKEN_BLOCK_SIZE; i ++) {
+    block[i].next = compiler->freeSlots;
+    compiler->freeSlots = &block[i];
+  }
+}
+
+void freeTokenPool(void) {
+  TokenSlot *block;
+
+  while (compiler->tokenBlocks != NULL) {
+    block = compiler->tokenBlocks;
+    compiler->tokenBlocks = block->next;
+    free(block);
+  }
+  compiler->freeSlots = NULL;
 }
 
-Token* makeToken(TokenType tokenType, int lineNo, int colNo) {
-  Token *token = (Token*)malloc(sizeof(Token));
+Token* makeToken(TokenType tokenType, SourcePos offset) {
+  Token *token;
+
+  if (compiler->freeSlots == NULL)
+    growTokenPool();
+  token = &compiler->freeSlots->token;
+  compiler->freeSlots = compiler->freeSlots->next;
+  // The type is a whole byte of the word the offset shares; storing it
+  // last keeps it a single byte store
+  token->offset = offset;
+  token->length = 0;
   token->tokenType = tokenType;
-  token->lineNo = lineNo;
-  token->colNo = colNo;
   return token;
 }
 
+char *tokenText(Token *token, char *buf, int size) {
+  SourcePos from = token->offset - compiler->inputBase;
+  int length = token->length;
+
+  if ((length == 0) || (length >= size) || (from < 0) ||
+      (from + length > compiler->inputEnd - compiler->inputStart))
+    return NULL;
+  memcpy(buf, compiler->inputStart + from, length);
+  buf[length] = '\0';
+  return buf;
+}
+
+// Every token comes from a slot, so it is aligned as one
+void freeToken(Token *token) {
+  void *p = token;
+  TokenSlot *slot = (TokenSlot*) p;
+
+  slot->next = compiler->freeSlots;
+  compiler->freeSlots = slot;
+}
+
 char *tokenToString(TokenType tokenType) {
   switch (tokenType) {
   case TK_NONE: return "None";
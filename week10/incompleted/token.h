@@ -7,6 +7,9 @@
 #ifndef __TOKEN_H__
 #define __TOKEN_H__
 
+#include "reader.h"
+#include "atom.h"
+
 #define MAX_IDENT_LEN 15
 #define KEYWORDS_COUNT 20
 
@@ -24,17 +27,54 @@ typedef enum {
   SB_ASSIGN, SB_EQ, SB_NEQ, SB_LT, SB_LE, SB_GT, SB_GE,
   SB_PLUS, SB_MINUS, SB_TIMES, SB_SLASH,
   SB_LPAR, SB_RPAR, SB_LSEL, SB_RSEL
-} TokenType; 
+} TokenType;
+
+// A set of token types, one bit each
+typedef unsigned long long TokenSet;
+#define TOKEN_BIT(t) (1ULL << (t))
+#define inTokenSet(set, t) (((set) >> (t)) & 1)
 
+// What a token carries besides its type and position
+typedef union {
+  Atom atom;                    // TK_IDENT: the interned name
+  int value;                    // TK_NUMBER
+  char text[4];                 // TK_CHAR: the character, NUL terminated
+} TokenPayload;
+
+// 12 bytes: the offset, length and type share a 64-bit word and the
+// payload follows. The payload members keep the names consumers read them
+// by. Identifiers, numbers and char constants are spans of the source:
+// length is the number of bytes they take there, 0 when it is not known.
 typedef struct {
-  char string[MAX_IDENT_LEN + 1];
-  int lineNo, colNo;
-  TokenType tokenType;
-  int value;
-} Token;
+  unsigned long long offset : 40;       // a SourcePos
+  unsigned long long length : 16;
+  unsigned long long tokenType : 8;     // a TokenType
+  union {
+    Atom atom;
+    int value;
+    char string[4];
+  };
+} __attribute__((packed, aligned(4))) Token;
+
+// A slot of the token pool: a token in use, or a link to the next free one
+typedef union TokenSlot {
+  Token token;
+  union TokenSlot *next;
+} TokenSlot;
 
+// Fills the keyword table, once before any lookup
+void buildKeywordSlots(void);
 TokenType checkKeyword(char *string);
-Token* makeToken(TokenType tokenType, int lineNo, int colNo);
+// checkKeyword on length bytes of source text in any case
+TokenType checkKeywordSpan(const unsigned char *text, int length);
+Token* makeToken(TokenType tokenType, SourcePos offset);
+void freeToken(Token *token);
+// Releases every token of the calling thread's pool
+void freeTokenPool(void);
+// The source text of a span token, copied into buf of size bytes as a C
+// string; NULL when its length is not known, it does not fit, or its bytes
+// are no longer in the input window
+char *tokenText(Token *token, char *buf, int size);
 char *tokenToString(TokenType tokenType);
 
 
@@ -0,0 +1,202 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include "utf8.h"
+
+int utf8SequenceLength(int lead) {
+  if ((lead >= 0xC2) && (lead <= 0xDF)) return 2;
+  if ((lead >= 0xE0) && (lead <= 0xEF)) return 3;
+  if ((lead >= 0xF0) && (lead <= 0xF4)) return 4;
+  return 0;
+}
+
+// Checks the byte at the given index of a sequence (RFC 3629): the second
+// byte is restricted for a few leads to rule out overlong encodings,
+// surrogates and code points above U+10FFFF
+int utf8ValidContinuation(int lead, int index, int c) {
+  if (index == 1) {
+    switch (lead) {
+    case 0xE0: return (c >= 0xA0) && (c <= 0xBF);
+    case 0xED: return (c >= 0x80) && (c <= 0x9F);
+    case 0xF0: return (c >= 0x90) && (c <= 0xBF);
+    case 0xF4: return (c >= 0x80) && (c <= 0x8F);
+    }
+  }
+  return (c >= 0x80) && (c <= 0xBF);
+}
+
+const unsigned char *utf8SkipTextScalar(const unsigned char *p, const unsigned char *end) {
+  int c, len, i;
+
+  while (p < end) {
+    c = *p;
+    if (c == '*') break;
+    if (!isUtf8Byte(c)) {
+      p ++;
+      continue;
+    }
+    len = utf8SequenceLength(c);
+    if ((len == 0) || (end - p < len)) break;
+    for (i = 1; i < len; i ++)
+      if (!utf8ValidContinuation(c, i, p[i])) return p;
+    p += len;
+  }
+  return p;
+}
+
+// Backs up from block to the lead byte of a sequence that runs into it
+const unsigned char *utf8SequenceStart(const unsigned char *block, const unsigned char *start) {
+  int i;
+
+  for (i = 1; (i <= 3) && (block - i >= start); i ++) {
+    int c = block[-i];
+    if (c < 0xC0) {
+      if (c < 0x80) break;
+      continue;
+    }
+    if (((c >= 0xF0) && (i < 4)) || ((c >= 0xE0) && (i < 3)) || (i < 2))
+      return block - i;
+    break;
+  }
+  return block;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_SSSE3
+#include <immintrin.h>
+
+/*
+ * Block validation after Keiser and Lemire, "Validating UTF-8 in less than
+ * one instruction per byte". Each byte pair is classified by three nibble
+ * lookups whose intersection flags the errors; the third and fourth bytes
+ * of long sequences are checked against prev2/prev3.
+ */
+#define TOO_SHORT (1 << 0)
+#define TOO_LONG (1 << 1)
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+__attribute__((target("ssse3")))
+static inline __m128i highNibbles(__m128i v) {
+  return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+}
+
+__attribute__((target("ssse3")))
+static int utf8BlockError(__m128i input, __m128i prev) {
+  const __m128i byte1High =
+    _mm_setr_epi8(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		  TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+		  TOO_SHORT | OVERLONG_2,
+		  TOO_SHORT,
+		  TOO_SHORT | OVERLONG_3 | SURROGATE,
+		  (char) (TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4));
+  const __m128i byte1Low =
+    _mm_setr_epi8((char) (CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+		  (char) (CARRY | OVERLONG_2),
+		  (char) CARRY,
+		  (char) CARRY,
+		  (char) (CARRY | TOO_LARGE),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		  (char) (CARRY | TOO_LARGE | TOO_LARGE_1000));
+  const __m128i byte2High =
+    _mm_setr_epi8(TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		  (char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+		  (char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+		  (char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+		  (char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+		  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+  __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+  __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+  __m128i special, must23, error;
+
+  special = _mm_and_si128(_mm_and_si128(_mm_shuffle_epi8(byte1High, highNibbles(prev1)),
+					_mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+			  _mm_shuffle_epi8(byte2High, highNibbles(input)));
+  must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)),
+			_mm_subs_epu8(prev3, _mm_set1_epi8((char) (0xF0 - 0x80))));
+  error = _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char) 0x80)), special);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF;
+}
+
+// Whether the block ends inside a multi-byte sequence
+__attribute__((target("ssse3")))
+static int utf8BlockIncomplete(__m128i block) {
+  const __m128i maxValue =
+    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+		  -1, -1, -1, -1, -1, (char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(block, maxValue), _mm_setzero_si128())) != 0xFFFF;
+}
+
+__attribute__((target("ssse3")))
+const unsigned char *utf8SkipTextSsse3(const unsigned char *p, const unsigned char *end) {
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i index = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const unsigned char *block = p;
+  __m128i prev = _mm_setzero_si128();
+  __m128i input, keep;
+  int stars, k;
+
+  while (end - block >= 16) {
+    input = _mm_loadu_si128((const __m128i*) block);
+    stars = _mm_movemask_epi8(_mm_cmpeq_epi8(input, star));
+
+    if (stars != 0) {
+      // Bytes from the '*' on do not belong to the run: validate the
+      // prefix as if it were followed by blanks
+      k = __builtin_ctz(stars);
+      keep = _mm_cmplt_epi8(index, _mm_set1_epi8(k));
+      input = _mm_or_si128(_mm_and_si128(keep, input), _mm_andnot_si128(keep, _mm_set1_epi8(' ')));
+      if (utf8BlockError(input, prev))
+	return utf8SequenceStart(block, p);
+      return block + k;
+    }
+
+    // Pure ASCII after a complete sequence needs no further checks
+    if ((_mm_movemask_epi8(input) != 0) || utf8BlockIncomplete(prev))
+      if (utf8BlockError(input, prev))
+	return utf8SequenceStart(block, p);
+
+    prev = input;
+    block += 16;
+  }
+  return utf8SequenceStart(block, p);
+}
+
+// Set by initUtf8 when the CPU has SSSE3
+int hasSsse3 = 0;
+#endif
+
+void initUtf8(void) {
+#ifdef UTF8_SSSE3
+  hasSsse3 = __builtin_cpu_supports("ssse3");
+#endif
+}
+
+const unsigned char *utf8SkipText(const unsigned char *p, const unsigned char *end) {
+#ifdef UTF8_SSSE3
+  if (hasSsse3)
+    return utf8SkipTextSsse3(p, end);
+#endif
+  return utf8SkipTextScalar(p, end);
+}
@@ -0,0 +1,25 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __UTF8_H__
+#define __UTF8_H__
+
+// Bytes from 0x80 up only occur inside UTF-8 multi-byte sequences
+#define isUtf8Byte(c) ((c) >= 0x80)
+
+// Picks the validator for the CPU, once before any scanning
+void initUtf8(void);
+
+int utf8SequenceLength(int lead);
+int utf8ValidContinuation(int lead, int index, int c);
+
+// Validates UTF-8 text starting at p, which must be the start of a
+// sequence, and returns where it stopped: at the first '*', at an invalid
+// sequence, or where too few bytes remain to go on in bulk. The returned
+// pointer is always at a sequence boundary.
+const unsigned char *utf8SkipText(const unsigned char *p, const unsigned char *end);
+
+#endif
@@ -0,0 +1,278 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "vscan.h"
+
+#define isBlank(c) (((c) == ' ') || ((unsigned) ((c) - '\t') <= '\r' - '\t'))
+#define isDigit(c) ((unsigned) ((c) - '0') <= 9)
+#define isAlnum(c) (isDigit(c) || ((unsigned) (((c) | 0x20) - 'a') <= 'z' - 'a'))
+
+const unsigned char *vscanBlanksScalar(const unsigned char *p, const unsigned char *end) {
+  while ((p < end) && isBlank(*p))
+    p ++;
+  return p;
+}
+
+const unsigned char *vscanCommentTextScalar(const unsigned char *p, const unsigned char *end) {
+  while ((p < end) && (*p != '*') && (*p < 0x80))
+    p ++;
+  return p;
+}
+
+const unsigned char *vscanAlnumScalar(const unsigned char *p, const unsigned char *end) {
+  while ((p < end) && isAlnum(*p))
+    p ++;
+  return p;
+}
+
+const unsigned char *vscanDigitsScalar(const unsigned char *p, const unsigned char *end) {
+  while ((p < end) && isDigit(*p))
+    p ++;
+  return p;
+}
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define VSCAN_SIMD
+#include <immintrin.h>
+
+// Blanks are ' ' and the range '\t'..'\r': (c - '\t') <= 4 unsigned
+static inline __m128i blankMask16(__m128i v) {
+  __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+  return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+		      _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8('\r' - '\t')), d));
+}
+
+const unsigned char *vscanBlanksSse2(const unsigned char *p, const unsigned char *end) {
+  unsigned mask;
+
+  while (end - p >= 16) {
+    mask = ~_mm_movemask_epi8(blankMask16(_mm_loadu_si128((const __m128i*) p))) & 0xFFFF;
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return vscanBlanksScalar(p, end);
+}
+
+// The sign bit marks non-ASCII bytes, so only '*' needs a compare
+const unsigned char *vscanCommentTextSse2(const unsigned char *p, const unsigned char *end) {
+  __m128i v;
+  unsigned mask;
+
+  while (end - p >= 16) {
+    v = _mm_loadu_si128((const __m128i*) p);
+    mask = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return vscanCommentTextScalar(p, end);
+}
+
+// Unsigned (v - low) <= span, byte by byte
+static inline __m128i rangeMask16(__m128i v, char low, char span) {
+  __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(low));
+  return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+const unsigned char *vscanAlnumSse2(const unsigned char *p, const unsigned char *end) {
+  __m128i v, alnum;
+  unsigned mask;
+
+  while (end - p >= 16) {
+    v = _mm_loadu_si128((const __m128i*) p);
+    alnum = _mm_or_si128(rangeMask16(v, '0', 9),
+			 rangeMask16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z' - 'a'));
+    mask = ~_mm_movemask_epi8(alnum) & 0xFFFF;
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return vscanAlnumScalar(p, end);
+}
+
+const unsigned char *vscanDigitsSse2(const unsigned char *p, const unsigned char *end) {
+  unsigned mask;
+
+  while (end - p >= 16) {
+    mask = ~_mm_movemask_epi8(rangeMask16(_mm_loadu_si128((const __m128i*) p), '0', 9)) & 0xFFFF;
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return vscanDigitsScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const unsigned char *vscanBlanksAvx2(const unsigned char *p, const unsigned char *end) {
+  __m256i v, d, blank;
+  unsigned mask;
+
+  while (end - p >= 32) {
+    v = _mm256_loadu_si256((const __m256i*) p);
+    d = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    blank = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+			    _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8('\r' - '\t')), d));
+    mask = ~(unsigned) _mm256_movemask_epi8(blank);
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return vscanBlanksSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const unsigned char *vscanCommentTextAvx2(const unsigned char *p, const unsigned char *end) {
+  __m256i v;
+  unsigned mask;
+
+  while (end - p >= 32) {
+    v = _mm256_loadu_si256((const __m256i*) p);
+    mask = _mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'))));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return vscanCommentTextSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rangeMask32(__m256i v, char low, char span) {
+  __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(span)), d);
+}
+
+__attribute__((target("avx2")))
+const unsigned char *vscanAlnumAvx2(const unsigned char *p, const unsigned char *end) {
+  __m256i v, alnum;
+  unsigned mask;
+
+  while (end - p >= 32) {
+    v = _mm256_loadu_si256((const __m256i*) p);
+    alnum = _mm256_or_si256(rangeMask32(v, '0', 9),
+			    rangeMask32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a'));
+    mask = ~(unsigned) _mm256_movemask_epi8(alnum);
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return vscanAlnumSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const unsigned char *vscanDigitsAvx2(const unsigned char *p, const unsigned char *end) {
+  unsigned mask;
+
+  while (end - p >= 32) {
+    mask = ~(unsigned) _mm256_movemask_epi8(rangeMask32(_mm256_loadu_si256((const __m256i*) p), '0', 9));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return vscanDigitsSse2(p, end);
+}
+
+// Set by initVscan when the CPU has AVX2
+int hasAvx2 = 0;
+#endif
+
+void initVscan(void) {
+#ifdef VSCAN_SIMD
+  hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+const unsigned char *vscanBlanks(const unsigned char *p, const unsigned char *end) {
+#ifdef VSCAN_SIMD
+  if (hasAvx2)
+    return vscanBlanksAvx2(p, end);
+  return vscanBlanksSse2(p, end);
+#else
+  return vscanBlanksScalar(p, end);
+#endif
+}
+
+const unsigned char *vscanCommentText(const unsigned char *p, const unsigned char *end) {
+#ifdef VSCAN_SIMD
+  if (hasAvx2)
+    return vscanCommentTextAvx2(p, end);
+  return vscanCommentTextSse2(p, end);
+#else
+  return vscanCommentTextScalar(p, end);
+#endif
+}
+
+// Identifiers and numbers are mostly short: take the first bytes one at a
+// time and only start a vector scan for longer runs
+const unsigned char *vscanAlnum(const unsigned char *p, const unsigned char *end) {
+  int i;
+
+  for (i = 0; i < 8; i ++, p ++)
+    if ((p == end) || !isAlnum(*p)) return p;
+#ifdef VSCAN_SIMD
+  if (hasAvx2)
+    return vscanAlnumAvx2(p, end);
+  return vscanAlnumSse2(p, end);
+#else
+  return vscanAlnumScalar(p, end);
+#endif
+}
+
+const unsigned char *vscanDigits(const unsigned char *p, const unsigned char *end) {
+  int i;
+
+  for (i = 0; i < 8; i ++, p ++)
+    if ((p == end) || !isDigit(*p)) return p;
+#ifdef VSCAN_SIMD
+  if (hasAvx2)
+    return vscanDigitsAvx2(p, end);
+  return vscanDigitsSse2(p, end);
+#else
+  return vscanDigitsScalar(p, end);
+#endif
+}
+
+/******************************************************************/
+
+#define ONES 0x0101010101010101ULL
+
+// Value of 8 digits loaded little endian, the first digit in the low byte:
+// adjacent pairs, then quads, then halves are combined with one
+// multiply-add each
+static inline uint64_t digits8(uint64_t x) {
+  x -= ONES * '0';
+  x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+  x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+  return (x * 10000 + (x >> 32)) & 0xFFFFFFFFULL;
+}
+
+long long decimalValue(const unsigned char *p, int n) {
+  uint64_t value = 0, x;
+
+  while ((n > 0) && (*p == '0')) {
+    p ++;
+    n --;
+  }
+  // INT_MAX has 10 digits
+  if (n > 10)
+    return INT_MAX + 1LL;
+
+  if (n >= 8) {
+    memcpy(&x, p, 8);
+    value = digits8(x);
+    p += 8;
+    n -= 8;
+  }
+  for (; n > 0; n --)
+    value = value * 10 + (*p++ - '0');
+
+  if (value > INT_MAX)
+    return INT_MAX + 1LL;
+  return value;
+}
@@ -0,0 +1,33 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VSCAN_H__
+#define __VSCAN_H__
+
+// Picks the kernels for the CPU, once before any scanning
+void initVscan(void);
+
+// Span kernels: each returns the first byte in [p, end) that ends the run,
+// or end. They look at 16 or 32 bytes per step where the CPU allows.
+
+// Blanks (CHAR_SPACE: tab, line feed, vertical tab, form feed, carriage
+// return and space)
+const unsigned char *vscanBlanks(const unsigned char *p, const unsigned char *end);
+
+// Comment text up to the next '*' or non-ASCII byte
+const unsigned char *vscanCommentText(const unsigned char *p, const unsigned char *end);
+
+// Letters and digits, the tail of an identifier
+const unsigned char *vscanAlnum(const unsigned char *p, const unsigned char *end);
+
+// Decimal digits
+const unsigned char *vscanDigits(const unsigned char *p, const unsigned char *end);
+
+// Value of the n decimal digits at p, or INT_MAX + 1 if it does not fit
+// in an int
+long long decimalValue(const unsigned char *p, int n);
+
+#endif